@@ -0,0 +1,199 @@
+/**
+ * \file AsyncDB.cpp
+ * \brief Runs database requests on a worker thread, so the GUI does not block on the backend
+ **/
+
+#include "AsyncDB.hpp"
+
+#include <QApplication>
+#include <QCursor>
+#include <QEvent>
+#include <QMessageBox>
+
+using namespace configmaps;
+
+namespace xrock_gui_model
+{
+
+    namespace
+    {
+        const QEvent::Type completionEventType = static_cast<QEvent::Type>(QEvent::registerEventType());
+    }
+
+    // Carries a finished job from the worker to the thread of the AsyncDB
+    class AsyncDB::Dispatcher : public QObject
+    {
+    public:
+        class CompletionEvent : public QEvent
+        {
+        public:
+            explicit CompletionEvent(Job job) : QEvent(completionEventType), job(std::move(job)) {}
+            Job job;
+        };
+
+        explicit Dispatcher(AsyncDB *asyncDB) : asyncDB(asyncDB) {}
+
+        bool event(QEvent *e) override
+        {
+            if (e->type() != completionEventType)
+            {
+                return QObject::event(e);
+            }
+            asyncDB->finish(static_cast<CompletionEvent *>(e)->job);
+            return true;
+        }
+
+    private:
+        AsyncDB *asyncDB;
+    };
+
+    AsyncDB::AsyncDB(std::shared_ptr<DBInterface> db) : db(db), dispatcher(new Dispatcher(this)),
+                                                        pendingCalls(0), stop(false)
+    {
+        worker = std::thread([this]
+                             { runWorker(); });
+    }
+
+    AsyncDB::~AsyncDB()
+    {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            stop = true;
+            queue.clear();
+        }
+        queueCondition.notify_one();
+        worker.join();
+        // completion events which were not delivered yet are discarded together with the dispatcher
+        dispatcher.reset();
+        if (pendingCalls > 0 && QApplication::instance())
+        {
+            QApplication::restoreOverrideCursor();
+        }
+    }
+
+    void AsyncDB::setDB(std::shared_ptr<DBInterface> db)
+    {
+        this->db = db;
+    }
+
+    void AsyncDB::enqueue(QObject *context, std::function<void()> run, std::function<void()> complete)
+    {
+        Job job;
+        job.run = std::move(run);
+        job.complete = std::move(complete);
+        job.hasContext = context != nullptr;
+        job.context = context;
+        if (context)
+        {
+            std::shared_ptr<std::atomic<bool>> &flag = cancelFlags[context];
+            if (!flag)
+            {
+                flag = std::make_shared<std::atomic<bool>>(false);
+            }
+            job.cancelled = flag;
+        }
+        else
+        {
+            job.cancelled = std::make_shared<std::atomic<bool>>(false);
+        }
+        if (pendingCalls++ == 0)
+        {
+            // the busy cursor signals that the GUI is still usable
+            QApplication::setOverrideCursor(Qt::BusyCursor);
+        }
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            queue.push_back(std::move(job));
+        }
+        queueCondition.notify_one();
+    }
+
+    void AsyncDB::cancel(QObject *context)
+    {
+        auto it = cancelFlags.find(context);
+        if (it == cancelFlags.end())
+        {
+            return;
+        }
+        // calls issued later for the same object (or a new one at the same address) get a new flag
+        *(it->second) = true;
+        cancelFlags.erase(it);
+    }
+
+    void AsyncDB::runWorker()
+    {
+        while (true)
+        {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                queueCondition.wait(lock, [this]
+                                    { return stop || !queue.empty(); });
+                if (stop)
+                {
+                    return;
+                }
+                job = std::move(queue.front());
+                queue.pop_front();
+            }
+            if (!*job.cancelled)
+            {
+                // exceptions are stored in the future of the job
+                job.run();
+            }
+            // dropped jobs are reported as well, so the pending calls are counted correctly
+            job.run = nullptr;
+            QCoreApplication::postEvent(dispatcher.get(), new Dispatcher::CompletionEvent(std::move(job)));
+        }
+    }
+
+    void AsyncDB::finish(Job &job)
+    {
+        if (--pendingCalls == 0)
+        {
+            QApplication::restoreOverrideCursor();
+        }
+        if (*job.cancelled || (job.hasContext && job.context.isNull()))
+        {
+            return;
+        }
+        try
+        {
+            job.complete();
+        }
+        catch (const std::exception &e)
+        {
+            QMessageBox::critical(nullptr, "Error", QString::fromStdString(e.what()), QMessageBox::Ok);
+        }
+        catch (...)
+        {
+            QMessageBox::critical(nullptr, "Error", "The database request failed with an unknown error", QMessageBox::Ok);
+        }
+    }
+
+    std::shared_future<ConfigMap> AsyncDB::requestModel(const std::string &domain, const std::string &model,
+                                                        const std::string &version, bool limit, QObject *context,
+                                                        std::function<void(const ConfigMap &)> done)
+    {
+        return call<ConfigMap>([domain, model, version, limit](DBInterface &db)
+                               { return db.requestModel(domain, model, version, limit); },
+                               context, done);
+    }
+
+    std::shared_future<std::vector<std::string>> AsyncDB::requestVersions(const std::string &domain, const std::string &model, QObject *context,
+                                                                          std::function<void(const std::vector<std::string> &)> done)
+    {
+        return call<std::vector<std::string>>([domain, model](DBInterface &db)
+                                              { return db.requestVersions(domain, model); },
+                                              context, done);
+    }
+
+    std::shared_future<bool> AsyncDB::storeModel(const ConfigMap &map, QObject *context,
+                                                 std::function<void(const bool &)> done)
+    {
+        return call<bool>([map](DBInterface &db)
+                          { return db.storeModel(map); },
+                          context, done);
+    }
+
+} // end of namespace xrock_gui_model
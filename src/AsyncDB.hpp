@@ -0,0 +1,126 @@
+/**
+ * \file AsyncDB.hpp
+ * \brief Runs database requests on a worker thread, so the GUI does not block on the backend
+ **/
+
+#pragma once
+#include "DBInterface.hpp"
+
+#include <QObject>
+#include <QPointer>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace xrock_gui_model
+{
+
+    /**
+     * @brief Runs calls of a DBInterface on a worker thread.
+     *
+     * Calls are executed one after another in the order they were issued, so a
+     * request issued after a store sees the stored model. The completion callback
+     * of a call is invoked by the event loop of the thread which created the
+     * AsyncDB (the GUI thread); if the call throws, an error dialog is shown
+     * instead. While calls are pending the busy cursor is shown.
+     *
+     * A call issued with a context object is cancelled by cancel(context): if it
+     * did not start yet it is dropped, otherwise its callback is not invoked. The
+     * callback is also skipped if the context was destroyed in the meantime.
+     * The future of a dropped call throws std::future_error.
+     *
+     * Calls and cancel() must be issued from the thread which created the AsyncDB.
+     * As the GUI still uses the backend directly for cheap requests, the backend
+     * is used from two threads; XRockGUI always puts a CachingDB in front of it,
+     * which holds one lock around every call of the backend.
+     */
+    class AsyncDB
+    {
+    public:
+        explicit AsyncDB(std::shared_ptr<DBInterface> db = nullptr);
+        // Drops all calls which did not start yet and waits for the running one
+        ~AsyncDB();
+        AsyncDB(const AsyncDB &) = delete;
+        AsyncDB &operator=(const AsyncDB &) = delete;
+
+        // Calls issued afterwards use the given backend, issued calls keep the previous one alive
+        void setDB(std::shared_ptr<DBInterface> db);
+        const std::shared_ptr<DBInterface> &getDB() const { return db; }
+
+        template <typename R>
+        std::shared_future<R> call(std::function<R(DBInterface &)> request, QObject *context = nullptr,
+                                   std::function<void(const R &)> done = nullptr)
+        {
+            std::shared_ptr<DBInterface> backend = db;
+            auto task = std::make_shared<std::packaged_task<R()>>([backend, request]
+                                                                  {
+                                                                      if (!backend)
+                                                                          throw std::runtime_error("No database selected");
+                                                                      return request(*backend);
+                                                                  });
+            std::shared_future<R> result = task->get_future().share();
+            enqueue(context, [task]
+                    { (*task)(); },
+                    [result, done]
+                    {
+                        // rethrows the exception of the request
+                        const R &value = result.get();
+                        if (done)
+                            done(value);
+                    });
+            return result;
+        }
+
+        std::shared_future<configmaps::ConfigMap> requestModel(const std::string &domain, const std::string &model,
+                                                               const std::string &version, bool limit, QObject *context,
+                                                               std::function<void(const configmaps::ConfigMap &)> done);
+        std::shared_future<std::vector<std::string>> requestVersions(const std::string &domain, const std::string &model, QObject *context,
+                                                                     std::function<void(const std::vector<std::string> &)> done);
+        std::shared_future<bool> storeModel(const configmaps::ConfigMap &map, QObject *context,
+                                            std::function<void(const bool &)> done);
+
+        // Drops the pending calls of the context and suppresses the callbacks of running ones
+        void cancel(QObject *context);
+        // Number of issued calls whose completion was not handled yet
+        size_t getPendingCalls() const { return pendingCalls; }
+
+    private:
+        class Dispatcher;
+        struct Job
+        {
+            std::shared_ptr<std::atomic<bool>> cancelled;
+            // invoked on the worker thread
+            std::function<void()> run;
+            // invoked on the thread of the AsyncDB
+            std::function<void()> complete;
+            bool hasContext;
+            QPointer<QObject> context;
+        };
+
+        std::shared_ptr<DBInterface> db;
+        // receives the completion events, lives in the thread of the AsyncDB
+        std::unique_ptr<Dispatcher> dispatcher;
+        size_t pendingCalls;
+        // flag of the calls of each context, replaced once the context is cancelled
+        std::map<QObject *, std::shared_ptr<std::atomic<bool>>> cancelFlags;
+
+        std::mutex queueMutex;
+        std::condition_variable queueCondition;
+        std::deque<Job> queue;
+        bool stop;
+        std::thread worker;
+
+        void enqueue(QObject *context, std::function<void()> run, std::function<void()> complete);
+        void finish(Job &job);
+        void runWorker();
+    };
+
+} // end of namespace xrock_gui_model
@@ -2,6 +2,8 @@
 
 #include <mars/utils/misc.h>
 
+#include <algorithm>
+
 using namespace configmaps;
 
 namespace xrock_gui_model
@@ -384,4 +386,32 @@ namespace xrock_gui_model
         }
     }
 
+    std::vector<std::tuple<std::string, std::string, std::string>> BasicModelHelper::getComponentModels(ConfigMap &model)
+    {
+        std::vector<std::tuple<std::string, std::string, std::string>> uses;
+        if (!model.hasKey("versions") || model["versions"].size() == 0)
+        {
+            return uses;
+        }
+        ConfigMap &version = model["versions"][0];
+        if (!version.hasKey("components") || !version["components"].hasKey("nodes"))
+        {
+            return uses;
+        }
+        for (auto &node : version["components"]["nodes"])
+        {
+            if (!node.hasKey("model") || !node["model"].hasKey("name"))
+            {
+                continue;
+            }
+            ConfigMap &used = node["model"];
+            uses.emplace_back(used.hasKey("domain") ? used["domain"].getString() : std::string(""),
+                              used["name"].getString(),
+                              used.hasKey("version") ? used["version"].getString() : std::string(""));
+        }
+        std::sort(uses.begin(), uses.end());
+        uses.erase(std::unique(uses.begin(), uses.end()), uses.end());
+        return uses;
+    }
+
 } // end of namespace xrock_gui_model
@@ -8,6 +8,10 @@
 #pragma once
 #include <configmaps/ConfigData.h>
 
+#include <string>
+#include <tuple>
+#include <vector>
+
 namespace xrock_gui_model
 {
 
@@ -36,6 +40,10 @@ namespace xrock_gui_model
 
         // Reverse conversion from convertFromLegacyModelFormat
         static void convertToLegacyModelFormat(configmaps::ConfigMap &model);
+
+        // Returns domain, name and version of the models referenced by versions[0].components.nodes[],
+        // sorted and without duplicates. Works for both model formats.
+        static std::vector<std::tuple<std::string, std::string, std::string>> getComponentModels(configmaps::ConfigMap &model);
     };
 } // end of namespace xrock_gui_model
 
@@ -1,6 +1,7 @@
 #include "BuildModuleDialog.hpp"
 #include "XRockGUI.hpp"
 #include "ComponentModelInterface.hpp"
+#include "AsyncDB.hpp"
 #include <mars/config_map_gui/DataWidget.h>
 #include <mars/utils/misc.h>
 
@@ -9,7 +10,6 @@
 #include <QSplitter>
 #include <QFrame>
 #include <QMessageBox>
-#include "utils/WaitCursorRAII.hpp"
 
 using namespace configmaps;
 
@@ -22,7 +22,7 @@ namespace xrock_gui_model
         setWindowTitle("Build Module Dialog");
         setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
         //  layouts
-        QVBoxLayout *layout = new QVBoxLayout(this);
+        layout = new QVBoxLayout(this);
         QHBoxLayout *hlayout = new QHBoxLayout();
 
         QLabel *label = new QLabel("Module Name");
@@ -35,22 +35,44 @@ namespace xrock_gui_model
         ComponentModelInterface *cm = dynamic_cast<ComponentModelInterface *>(xrockGui->getBagelGui()->getCurrentModel());
         ConfigMap map = cm->getModelInfo();
         uriToplvlcm = map["uri"].getString();
-        // get unresolved abstract within the model network
-        ConfigMap data;
-        {
-            WaitCursorRAII _;
-            data = xrockGui->db->getUnresolvedAbstracts(uriToplvlcm);
-        }
+
+        // buttons
+        listWidget = new QListWidget();
+        button = new QPushButton("Build");
+        connect(button, SIGNAL(clicked()), this, SLOT(onBuildButtonClicked()));
+        layout->addWidget(button);
+
+        setLayout(layout);
+        adjustSize();
+        setMinimumWidth(640);
+        //setMinimumHeight(640);
+
+        // get unresolved abstract within the model network, building is possible once they are known
+        button->setEnabled(false);
+        const std::string uri = uriToplvlcm;
+        xrockGui->getAsyncDB().call<ConfigMap>([uri](DBInterface &db)
+                                               { return db.getUnresolvedAbstracts(uri); },
+                                               this, [this](const ConfigMap &data)
+                                               {
+            showUnresolvedAbstracts(data);
+            button->setEnabled(true); });
+    }
+
+    void BuildModuleDialog::showUnresolvedAbstracts(const ConfigMap &result)
+    {
+        ConfigMap data = result;
+        // the section is placed above the build button
+        int index = layout->indexOf(button);
         if (data["unresolved_abstracts"].size() > 0)
         {
             QFrame *separator = new QFrame;
             separator->setFrameShape(QFrame::HLine);
             separator->setFrameShadow(QFrame::Sunken);
 
-            layout->addWidget(separator);
+            layout->insertWidget(index++, separator);
             //add a header for user
             QLabel *header = new QLabel("Unresolved abstracts:");
-            layout->addWidget(header);
+            layout->insertWidget(index++, header);
             listWidget = new QListWidget(this);
 
             // Unresolved abstracts:
@@ -88,20 +110,10 @@ namespace xrock_gui_model
                 // save the references to the Qcombobox and Qlable so that we have it in the map
                 selectedImplementationsWidgets[display_abstract_name_label] = combox;
             }
-            layout->addWidget(listWidget);
+            layout->insertWidget(index, listWidget);
+            adjustSize();
         }
-
-        // buttons
-        listWidget = new QListWidget();
-        button = new QPushButton("Build");
-        connect(button, SIGNAL(clicked()), this, SLOT(onBuildButtonClicked()));
-        layout->addWidget(button);
-
-        setLayout(layout);
-        adjustSize();
-        setMinimumWidth(640);
-        //setMinimumHeight(640);
-    } 
+    }
 
     void BuildModuleDialog::onBuildButtonClicked()
     {
@@ -122,39 +134,50 @@ namespace xrock_gui_model
             selected_implementations[abstract_uri.toStdString()] = impl_uri.toStdString();
         }
 
+        // the requests run in the background, the button stays disabled until they are done
+        button->setEnabled(false);
         // 3. before we call db.buildModule(), we save the current model( if has changes)
         //TODO: hasChanges returns true even if there were no changes.
         if (xrockGui->getBagelGui()->getCurrentTabView()->hasChanges())
         {
-            bool stored;
-            {
-                WaitCursorRAII _; 
-                stored = xrockGui->storeComponentModel();
-            }
-            if (!stored)
+            xrockGui->storeComponentModel([this, selected_implementations](bool stored)
+                                          {
+                if (!stored)
+                {
+                    //TODO: check history
+                    QMessageBox::critical(nullptr, "Error", "Could not store component model to database", QMessageBox::Ok);
+                    button->setEnabled(true);
+                    return;
+                }
+                buildModule(selected_implementations); },
+                                          this);
+            return;
+        }
+        buildModule(selected_implementations);
+    }
+
+    void BuildModuleDialog::buildModule(const std::map<std::string, std::string> &selected_implementations)
+    {
+        const std::string uri = uriToplvlcm;
+        const std::string moduleName = moduleNameEdit->text().toStdString();
+        xrockGui->getAsyncDB().call<bool>([uri, moduleName, selected_implementations](DBInterface &db)
+                                          { return db.buildModule(uri, moduleName, selected_implementations); },
+                                          this, [this](const bool &build)
+                                          {
+            if (!build)
             {
-                //TODO: check history
-                QMessageBox::critical(nullptr, "Error", "Could not store component model to database", QMessageBox::Ok);
-                
+                QMessageBox::critical(nullptr, "Error", "Could not build Module to database", QMessageBox::Ok);
+                button->setEnabled(true);
                 return;
             }
-        }
-        bool build;
-        {
-            WaitCursorRAII _; 
-            build = xrockGui->db->buildModule(uriToplvlcm, moduleNameEdit->text().toStdString(), selected_implementations);
-        }
-        if (!build)
-        {
-            QMessageBox::critical(nullptr, "Error", "Could not build Module to database", QMessageBox::Ok);
-            return;
-        }
-        QMessageBox::information(nullptr, "Success", "Module has been successfully saved into database", QMessageBox::Ok);
-        close();
+            QMessageBox::information(nullptr, "Success", "Module has been successfully saved into database", QMessageBox::Ok);
+            close(); });
     }
 
     BuildModuleDialog::~BuildModuleDialog()
     {
+        // drop the requests of the dialog, their results are not of interest anymore
+        xrockGui->getAsyncDB().cancel(this);
         // Destructor implementation
         // delete comboBox;
     }
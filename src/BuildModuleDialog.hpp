@@ -14,6 +14,8 @@
 #include <QEventLoop>
 #include <QComboBox>
 #include <QLabel>
+#include <QVBoxLayout>
+#include <map>
 
 namespace mars
 {
@@ -40,6 +42,7 @@ namespace xrock_gui_model
         void onBuildButtonClicked();
 
     private:
+        QVBoxLayout *layout;
         QPushButton *button;
         QLineEdit *moduleNameEdit;
 
@@ -54,5 +57,8 @@ namespace xrock_gui_model
         std::map<QLabel*, QComboBox *> selectedImplementationsWidgets; // to cache the infor of lable and Qcomboboy
         std::string uriToplvlcm;
         // std::string selectedVersion;
+
+        void showUnresolvedAbstracts(const configmaps::ConfigMap &result);
+        void buildModule(const std::map<std::string, std::string> &selected_implementations);
         };
     } // end of namespace xrock_gui_model
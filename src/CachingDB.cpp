@@ -0,0 +1,346 @@
+/**
+ * \file CachingDB.cpp
+ * \brief Keeps recently requested model versions of any database backend in memory
+ **/
+
+#include "CachingDB.hpp"
+
+#include <iterator>
+
+using namespace configmaps;
+
+namespace xrock_gui_model
+{
+
+    CachingDB::CachingDB(DBInterface *backend, size_t capacity, std::chrono::milliseconds negativeLifetime)
+        : backend(backend), capacity(capacity), negativeLifetime(negativeLifetime), backendListenerId(-1),
+          generation(0), hits(0), misses(0)
+    {
+        // other processes writing into the database invalidate what we have seen
+        backendListenerId = this->backend->addChangeListener([this](const std::string &domain, const std::string &model)
+                                                             { invalidate(domain, model); });
+    }
+
+    CachingDB::~CachingDB()
+    {
+        std::lock_guard<std::recursive_mutex> lock(backendMutex);
+        if (backendListenerId >= 0)
+        {
+            backend->removeChangeListener(backendListenerId);
+        }
+    }
+
+    bool CachingDB::lookup(const Key &key, ConfigMap *map, size_t *requestGeneration)
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        *requestGeneration = generation;
+        auto it = entries.find(key);
+        if (it != entries.end())
+        {
+            lru.splice(lru.begin(), lru, it->second);
+            *map = it->second->second;
+            ++hits;
+            return true;
+        }
+        auto miss = missing.find(key);
+        if (miss != missing.end())
+        {
+            if (std::chrono::steady_clock::now() - miss->second < negativeLifetime)
+            {
+                *map = ConfigMap();
+                ++hits;
+                return true;
+            }
+            missing.erase(miss);
+        }
+        ++misses;
+        return false;
+    }
+
+    void CachingDB::insert(const Key &key, const ConfigMap &map, size_t requestGeneration)
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        if (capacity == 0 || requestGeneration != generation)
+        {
+            // invalidated while the backend was asked, the result may be outdated already
+            return;
+        }
+        if (map.empty())
+        {
+            const auto now = std::chrono::steady_clock::now();
+            if (missing.size() >= capacity)
+            {
+                for (auto it = missing.begin(); it != missing.end();)
+                {
+                    it = now - it->second < negativeLifetime ? std::next(it) : missing.erase(it);
+                }
+            }
+            missing[key] = now;
+            return;
+        }
+        auto it = entries.find(key);
+        if (it != entries.end())
+        {
+            it->second->second = map;
+            lru.splice(lru.begin(), lru, it->second);
+            return;
+        }
+        lru.emplace_front(key, map);
+        entries[key] = lru.begin();
+        if (lru.size() > capacity)
+        {
+            entries.erase(lru.back().first);
+            lru.pop_back();
+        }
+    }
+
+    void CachingDB::invalidate(const std::string &domain, const std::string &model)
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        ++generation;
+        if (model.empty())
+        {
+            lru.clear();
+            entries.clear();
+            missing.clear();
+            return;
+        }
+        auto matches = [&](const Key &key)
+        {
+            return std::get<1>(key) == model && (domain.empty() || std::get<0>(key) == domain);
+        };
+        for (auto it = lru.begin(); it != lru.end();)
+        {
+            if (matches(it->first))
+            {
+                entries.erase(it->first);
+                it = lru.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        for (auto it = missing.begin(); it != missing.end();)
+        {
+            it = matches(it->first) ? missing.erase(it) : std::next(it);
+        }
+    }
+
+    void CachingDB::clear()
+    {
+        invalidate("", "");
+    }
+
+    std::vector<std::pair<std::string, std::string>> CachingDB::requestModelListByDomain(const std::string &domain)
+    {
+        std::lock_guard<std::recursive_mutex> lock(backendMutex);
+        return backend->requestModelListByDomain(domain);
+    }
+
+    std::vector<std::string> CachingDB::requestVersions(const std::string &domain, const std::string &model)
+    {
+        std::lock_guard<std::recursive_mutex> lock(backendMutex);
+        return backend->requestVersions(domain, model);
+    }
+
+    ConfigMap CachingDB::requestModel(const std::string &domain,
+                                      const std::string &model,
+                                      const std::string &version,
+                                      const bool limit)
+    {
+        if (!isCacheable(version, limit))
+        {
+            std::lock_guard<std::recursive_mutex> lock(backendMutex);
+            return backend->requestModel(domain, model, version, limit);
+        }
+        const Key key(domain, model, version);
+        ConfigMap map;
+        size_t requestGeneration;
+        if (lookup(key, &map, &requestGeneration))
+        {
+            return map;
+        }
+        {
+            std::lock_guard<std::recursive_mutex> lock(backendMutex);
+            map = backend->requestModel(domain, model, version, limit);
+        }
+        insert(key, map, requestGeneration);
+        return map;
+    }
+
+    LazyModel CachingDB::requestModelLazy(const std::string &domain, const std::string &model)
+    {
+        std::vector<std::string> versions;
+        {
+            std::lock_guard<std::recursive_mutex> lock(backendMutex);
+            versions = backend->requestModelLazy(domain, model).getVersionNames();
+        }
+        // the loaders of the backend would bypass the lock, the versions are loaded through this cache instead
+        return LazyModel(
+            versions,
+            [this, domain, model](const std::string &version)
+            { return requestModel(domain, model, version, true); },
+            [this, domain, model](const std::vector<std::string> &versions)
+            {
+                std::vector<std::tuple<std::string, std::string, std::string>> requests;
+                for (const auto &version : versions)
+                {
+                    requests.emplace_back(domain, model, version);
+                }
+                return requestModels(requests);
+            });
+    }
+
+    std::vector<ConfigMap> CachingDB::requestModels(const std::vector<std::tuple<std::string, std::string, std::string>> &models)
+    {
+        std::vector<ConfigMap> result(models.size());
+        std::vector<std::tuple<std::string, std::string, std::string>> requests;
+        std::vector<size_t> requestPositions;
+        // the first lookup tells the generation, later invalidations only prevent the insert
+        size_t requestGeneration = 0;
+        bool first = true;
+        for (size_t i = 0; i < models.size(); ++i)
+        {
+            size_t lookupGeneration;
+            if (std::get<2>(models[i]).empty() || !lookup(models[i], &result[i], &lookupGeneration))
+            {
+                requests.push_back(models[i]);
+                requestPositions.push_back(i);
+            }
+            if (first && !std::get<2>(models[i]).empty())
+            {
+                requestGeneration = lookupGeneration;
+                first = false;
+            }
+        }
+        if (requests.empty())
+        {
+            return result;
+        }
+        std::vector<ConfigMap> loaded;
+        {
+            std::lock_guard<std::recursive_mutex> lock(backendMutex);
+            loaded = backend->requestModels(requests);
+        }
+        for (size_t i = 0; i < requests.size() && i < loaded.size(); ++i)
+        {
+            if (!std::get<2>(requests[i]).empty())
+            {
+                insert(requests[i], loaded[i], requestGeneration);
+            }
+            result[requestPositions[i]] = loaded[i];
+        }
+        return result;
+    }
+
+    std::vector<std::tuple<std::string, std::string, std::string>> CachingDB::requestDependents(const std::string &domain,
+                                                                                               const std::string &model,
+                                                                                               const std::string &version)
+    {
+        std::lock_guard<std::recursive_mutex> lock(backendMutex);
+        return backend->requestDependents(domain, model, version);
+    }
+
+    bool CachingDB::storeModel(const ConfigMap &map)
+    {
+        bool stored;
+        {
+            std::lock_guard<std::recursive_mutex> lock(backendMutex);
+            stored = backend->storeModel(map);
+        }
+        // invalidate even on failure, the backend may have written parts of the model
+        ConfigMap copy = map;
+        invalidate(copy.hasKey("domain") ? copy["domain"].getString() : std::string(""),
+                   copy.hasKey("name") ? copy["name"].getString() : std::string(""));
+        return stored;
+    }
+
+    bool CachingDB::removeModel(const std::string &uri)
+    {
+        bool removed;
+        {
+            std::lock_guard<std::recursive_mutex> lock(backendMutex);
+            removed = backend->removeModel(uri);
+        }
+        // the format of the uri depends on the backend
+        clear();
+        return removed;
+    }
+
+    void CachingDB::setDbGraph(const std::string &dbGraph)
+    {
+        {
+            std::lock_guard<std::recursive_mutex> lock(backendMutex);
+            backend->setDbGraph(dbGraph);
+        }
+        clear();
+    }
+
+    void CachingDB::setDbAddress(const std::string &dbAddress)
+    {
+        {
+            std::lock_guard<std::recursive_mutex> lock(backendMutex);
+            backend->setDbAddress(dbAddress);
+        }
+        clear();
+    }
+
+    void CachingDB::setDbPath(const fs::path &dbPath)
+    {
+        {
+            std::lock_guard<std::recursive_mutex> lock(backendMutex);
+            backend->setDbPath(dbPath);
+        }
+        clear();
+    }
+
+    bool CachingDB::isConnected()
+    {
+        std::lock_guard<std::recursive_mutex> lock(backendMutex);
+        return backend->isConnected();
+    }
+
+    int CachingDB::addChangeListener(ChangeListener listener)
+    {
+        std::lock_guard<std::recursive_mutex> lock(backendMutex);
+        return backend->addChangeListener(listener);
+    }
+
+    void CachingDB::removeChangeListener(int id)
+    {
+        std::lock_guard<std::recursive_mutex> lock(backendMutex);
+        backend->removeChangeListener(id);
+    }
+
+    ConfigMap CachingDB::getPropertiesOfComponentModel()
+    {
+        std::lock_guard<std::recursive_mutex> lock(backendMutex);
+        return backend->getPropertiesOfComponentModel();
+    }
+
+    std::vector<std::string> CachingDB::getDomains()
+    {
+        std::lock_guard<std::recursive_mutex> lock(backendMutex);
+        return backend->getDomains();
+    }
+
+    ConfigMap CachingDB::getEmptyComponentModel()
+    {
+        std::lock_guard<std::recursive_mutex> lock(backendMutex);
+        return backend->getEmptyComponentModel();
+    }
+
+    bool CachingDB::buildModule(const std::string &uri, const std::string &moduleName, const std::map<std::string, std::string> &selected_implementations)
+    {
+        std::lock_guard<std::recursive_mutex> lock(backendMutex);
+        return backend->buildModule(uri, moduleName, selected_implementations);
+    }
+
+    ConfigMap CachingDB::getUnresolvedAbstracts(const std::string &uri)
+    {
+        std::lock_guard<std::recursive_mutex> lock(backendMutex);
+        return backend->getUnresolvedAbstracts(uri);
+    }
+
+} // end of namespace xrock_gui_model
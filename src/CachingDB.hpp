@@ -0,0 +1,108 @@
+/**
+ * \file CachingDB.hpp
+ * \brief Keeps recently requested model versions of any database backend in memory
+ **/
+
+#pragma once
+#include "DBInterface.hpp"
+
+#include <chrono>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+namespace xrock_gui_model
+{
+
+    /**
+     * @brief Read-through cache in front of another DBInterface.
+     *
+     * Single model versions (requestModel() with a version and limit set) are
+     * kept in a least recently used cache of bounded size. Requests for versions
+     * which do not exist are remembered for a short time as well. Both are
+     * invalidated by storeModel(), removeModel(), a change of the database
+     * address and the change notifications of the backend. All other requests
+     * are passed through. With a capacity of 0 nothing is cached.
+     *
+     * Every call of the backend holds one lock, so the backend is never used by
+     * two threads at once (e.g. the AsyncDB worker and the GUI thread); the
+     * versions of the LazyModels it returns are loaded through this cache as well.
+     */
+    class CachingDB : public DBInterface
+    {
+    public:
+        // Takes ownership of backend. capacity: number of model versions kept.
+        // negativeLifetime: how long a missing version is reported without asking the backend again
+        CachingDB(DBInterface *backend, size_t capacity = 256,
+                  std::chrono::milliseconds negativeLifetime = std::chrono::seconds(10));
+        ~CachingDB();
+
+        std::vector<std::pair<std::string, std::string>> requestModelListByDomain(const std::string &domain) override;
+        std::vector<std::string> requestVersions(const std::string &domain, const std::string &model) override;
+        configmaps::ConfigMap requestModel(const std::string &domain,
+                                           const std::string &model,
+                                           const std::string &version,
+                                           const bool limit = false) override;
+        LazyModel requestModelLazy(const std::string &domain, const std::string &model) override;
+        // Serves the cached versions and requests the others from the backend in one batch
+        std::vector<configmaps::ConfigMap> requestModels(const std::vector<std::tuple<std::string, std::string, std::string>> &models) override;
+        std::vector<std::tuple<std::string, std::string, std::string>> requestDependents(const std::string &domain,
+                                                                                        const std::string &model,
+                                                                                        const std::string &version) override;
+        bool storeModel(const configmaps::ConfigMap &map) override;
+        bool removeModel(const std::string &uri) override;
+        void setDbGraph(const std::string &dbGraph) override;
+        void setDbAddress(const std::string &dbAddress) override;
+        void setDbPath(const fs::path &dbPath) override;
+        bool isConnected() override;
+        int addChangeListener(ChangeListener listener) override;
+        void removeChangeListener(int id) override;
+        configmaps::ConfigMap getPropertiesOfComponentModel() override;
+        std::vector<std::string> getDomains() override;
+        configmaps::ConfigMap getEmptyComponentModel() override;
+        bool buildModule(const std::string &uri, const std::string &moduleName, const std::map<std::string, std::string> &selected_implementations) override;
+        configmaps::ConfigMap getUnresolvedAbstracts(const std::string &uri) override;
+
+        // Calls of the backend itself are not serialized, only for backends which synchronize themselves (FileDB)
+        DBInterface *getBackend() const { return backend.get(); }
+        // Drops all cached versions and misses
+        void clear();
+        size_t getHits() const { return hits; }
+        size_t getMisses() const { return misses; }
+
+    private:
+        // domain, model, version
+        typedef std::tuple<std::string, std::string, std::string> Key;
+        typedef std::list<std::pair<Key, configmaps::ConfigMap>> LruList;
+
+        std::unique_ptr<DBInterface> backend;
+        size_t capacity;
+        std::chrono::milliseconds negativeLifetime;
+        int backendListenerId;
+        // held around every call of the backend; recursive as change listeners may call back into this
+        std::recursive_mutex backendMutex;
+
+        std::mutex cacheMutex;
+        // most recently used first
+        LruList lru;
+        std::map<Key, LruList::iterator> entries;
+        // versions which did not exist and when they were requested
+        std::map<Key, std::chrono::steady_clock::time_point> missing;
+        // incremented by every invalidation, results requested before are not cached
+        size_t generation;
+        size_t hits;
+        size_t misses;
+
+        static bool isCacheable(const std::string &version, bool limit) { return limit && !version.empty(); }
+        // Returns true and fills map if the request can be answered from the cache,
+        // requestGeneration is to be passed to insert() along with the result of the backend
+        bool lookup(const Key &key, configmaps::ConfigMap *map, size_t *requestGeneration);
+        void insert(const Key &key, const configmaps::ConfigMap &map, size_t requestGeneration);
+        // Drops all versions of the model; an empty model drops everything, an empty domain matches any domain
+        void invalidate(const std::string &domain, const std::string &model);
+    };
+
+} // end of namespace xrock_gui_model
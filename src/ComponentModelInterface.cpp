@@ -7,13 +7,15 @@
 #include "ComponentModelInterface.hpp"
 #include "ConfigMapHelper.hpp"
 #include "BasicModelHelper.hpp"
+#include "NodeDefinitionScanner.hpp"
+#include "ComponentTypeRegistry.hpp"
 #include <osg_graph_viz/Node.hpp>
 #include <bagel_gui/BagelGui.hpp>
 #include <QMessageBox>
 
 #include <mars/utils/misc.h>
-#include <dirent.h>
 #include <iostream>
+#include <set>
 using namespace bagel_gui;
 using namespace configmaps;
 using namespace mars::utils;
@@ -24,7 +26,9 @@ namespace xrock_gui_model
     ComponentModelInterface::ComponentModelInterface(BagelGui *bagelGui, XRockGUI *xrockGui) : ModelInterface(bagelGui), xrockGui(xrockGui)
     {
         simpleTypeGen = false;
+        basicModel = std::make_shared<ConfigMap>();
         std::string confDir = bagelGui->getConfigDir();
+        typeRegistry = ComponentTypeRegistry::getShared(confDir);
         ConfigMap config = ConfigMap::fromYamlFile(confDir + "/config_default.yml", true);
         if (mars::utils::pathExists(confDir + "/config.yml"))
         {
@@ -64,7 +68,7 @@ namespace xrock_gui_model
         info.map["font_size"] = 28.;
         info.type = "DES";
         info.map["NodeClass"] = "GUINode";
-        nodeInfoMap[info.type] = info;
+        typeRegistry->add(info);
 
 
         // 20221110 MS: This functionality is not needed and clutters this class. We use orogen_to_xrock for this.
@@ -88,14 +92,15 @@ namespace xrock_gui_model
         }
     }
 
-    // TODO: Check whether all of this config maps need to be copied over.
+    // The node, edge and type maps as well as the basic model are shared with other until one side changes them,
+    // so a clone does not copy any model data
     ComponentModelInterface::ComponentModelInterface(const ComponentModelInterface *other)
         : ModelInterface(other->bagelGui),
           xrockGui(other->xrockGui),
           simpleTypeGen(other->simpleTypeGen),
           nodeMap(other->nodeMap),
           edgeMap(other->edgeMap),
-          nodeInfoMap(other->nodeInfoMap),
+          typeRegistry(other->typeRegistry),
           basicModel(other->basicModel)
     {
     }
@@ -113,50 +118,22 @@ namespace xrock_gui_model
     // 20221110 MS: As far as i can see it, this stuff is needed for bagel only. It has nothing to do with XRock, right?
     void ComponentModelInterface::loadNodeInfo(std::string path, bool orogen)
     {
-        if (path[path.size() - 1] != '/')
+        // the files are parsed once per process and only read again if they change
+        for (auto &map : NodeDefinitionScanner::scan(path))
         {
-            path += "/";
-        }
-        DIR *dir;
-        struct dirent *ent;
-        if ((dir = opendir(path.c_str())) != NULL)
-        {
-            // go through all entities
-            while ((ent = readdir(dir)) != NULL)
+            if (map.empty())
             {
-                std::string file = ent->d_name;
-
-                if (file.find(".yml", file.size() - 4, 4) != std::string::npos)
-                {
-                    // try to load the yaml-file
-                    ConfigMap map = ConfigMap::fromYamlFile(path + file);
-                    if (orogen)
-                    {
-                        addOrogenInfo(map);
-                    }
-                    else
-                    {
-                        addNodeInfo(deriveTypeFromNodeInfo(map), map);
-                    }
-                }
-                else if (file.find(".", 0, 1) != std::string::npos)
-                {
-                    // skip ".*"
-                }
-                else
-                {
-                    // go into the next dir
-                    loadNodeInfo(path + file + "/", orogen);
-                }
+                continue;
+            }
+            if (orogen)
+            {
+                addOrogenInfo(map);
+            }
+            else
+            {
+                addNodeInfo(deriveTypeFromNodeInfo(map), map);
             }
-            closedir(dir);
-        }
-        else
-        {
-            // this is not a directory
-            std::cerr << "Specified path " << path.c_str() << " is not a valid directory" << std::endl;
         }
-        return;
     }
 
     std::string ComponentModelInterface::deriveTypeFrom(const std::string &domain, const std::string &name, const std::string &version)
@@ -173,11 +150,11 @@ namespace xrock_gui_model
         return deriveTypeFrom(model["model"]["domain"].getString(), model["model"]["name"].getString(), model["model"]["versions"][0]["name"].getString());
     }
 
-    // This function actually adds the component model information of a node into the nodeInfoMap.
+    // This function actually adds the component model information of a node into the shared type registry.
     bool ComponentModelInterface::addNodeInfo(const std::string &type, configmaps::ConfigMap &model)
     {
         // Check if the type is already known. If so, do nothing
-        if (nodeInfoMap.find(type) != nodeInfoMap.end())
+        if (typeRegistry->has(type))
             return false;
 
         // Setup all information in the NodeInfo
@@ -225,10 +202,32 @@ namespace xrock_gui_model
             info.map["configuration"] = model["versions"][0]["defaultConfiguration"];
         }
 
-        // Register the new model in the nodeInfoMap data structure
-        nodeInfoMap[info.type] = info;
+        // Register the new model in the shared registry, another tab may have done so meanwhile
+        return typeRegistry->add(info);
+    }
 
-        return true;
+    bool ComponentModelInterface::restoreNodeInfo(const std::string &type, const configmaps::ConfigMap &map)
+    {
+        if (typeRegistry->has(type))
+            return false;
+
+        osg_graph_viz::NodeInfo info;
+        info.map = map;
+        info.type = type;
+        // the numbers are not part of the map, they follow from the inputs and outputs addNodeInfo() collected
+        info.numInputs = 0;
+        info.numOutputs = 0;
+        if (info.map.hasKey("inputs"))
+        {
+            ConfigVector &inputs = info.map["inputs"];
+            info.numInputs = inputs.size();
+        }
+        if (info.map.hasKey("outputs"))
+        {
+            ConfigVector &outputs = info.map["outputs"];
+            info.numOutputs = outputs.size();
+        }
+        return typeRegistry->add(info);
     }
 
     // TODO: Is this function deprecated? Because we normally import orogen models from orogen_to_xrock script
@@ -245,7 +244,7 @@ namespace xrock_gui_model
             {
                 std::string name = libName + "::" + it2.first;
                 std::string type = "software::" + name;
-                if (nodeInfoMap.find(type) != nodeInfoMap.end())
+                if (typeRegistry->has(type))
                     continue;
                 ConfigMap map;
                 map["modelVersion"] = "v0.1";
@@ -285,7 +284,7 @@ namespace xrock_gui_model
                 info.numInputs = numInputs;
                 info.numOutputs = numOutputs;
                 info.map = map;
-                nodeInfoMap[type] = info;
+                typeRegistry->add(info);
             }
         }
 
@@ -298,14 +297,14 @@ namespace xrock_gui_model
         ConfigMap &map = *node;
 
         // Check if the node has already been added
-        if (nodeMap.find(nodeId) != nodeMap.end())
+        if (nodeMap.contains(nodeId))
             return false;
 
         // TODO: Instead of these 'DES' nodes we should have a property called 'description'
         std::string nodeType = map["type"];
         if (nodeType == "DES")
             return true;
-        nodeMap[nodeId] = map;
+        nodeMap.set(nodeId, map);
         return true;
     }
 
@@ -322,7 +321,7 @@ namespace xrock_gui_model
         ConfigMap &map = *edge;
 
         // Check if we already have added the edge
-        if (edgeMap.find(edgeId) != edgeMap.end())
+        if (edgeMap.contains(edgeId))
             return false;
 
         // Check if edge info is valid
@@ -371,7 +370,7 @@ namespace xrock_gui_model
                 return false;
         }
 
-        edgeMap[edgeId] = map;
+        edgeMap.set(edgeId, map);
         return true;
     }
 
@@ -389,10 +388,11 @@ namespace xrock_gui_model
 
         for (auto it = edgeMap.begin(); it != edgeMap.end(); ++it)
         {
-            if (it->second["fromNode"] == map["fromNode"] &&
-                it->second["toNode"] == map["toNode"] &&
-                it->second["fromNodeOutput"] == map["fromNodeOutput"] &&
-                it->second["toNodeInput"] == map["toNodeInput"])
+            ConfigMap &other = *it->second;
+            if (other["fromNode"] == map["fromNode"] &&
+                other["toNode"] == map["toNode"] &&
+                other["fromNodeOutput"] == map["fromNodeOutput"] &&
+                other["toNodeInput"] == map["toNodeInput"])
             {
                 return true;
             }
@@ -415,7 +415,7 @@ namespace xrock_gui_model
 
     const std::map<std::string, osg_graph_viz::NodeInfo> &ComponentModelInterface::getNodeInfoMap()
     {
-        return nodeInfoMap;
+        return typeRegistry->getAll();
     }
 
     // This function removes a node from the nodeMap
@@ -428,9 +428,6 @@ namespace xrock_gui_model
     // This function removed an edge from the edgeMap
     bool ComponentModelInterface::removeEdge(unsigned long edgeId)
     {
-        if (edgeMap.find(edgeId) == edgeMap.end())
-            return true;
-
         edgeMap.erase(edgeId);
         return true;
     }
@@ -441,48 +438,49 @@ namespace xrock_gui_model
     {
         if (node["type"] == "DES")
             return true;
-        std::map<unsigned long, ConfigMap>::iterator it = nodeMap.find(nodeId);
-        if (it != nodeMap.end())
+        // copied first if a clone still shares the node
+        ConfigMap *current = nodeMap.modify(nodeId);
+        if (current)
         {
             // Do not allow changes to uri
-            if(it->second.hasKey("uri"))
+            if(current->hasKey("uri"))
             {
-                node["uri"] = it->second["uri"];
+                node["uri"] = (*current)["uri"];
             }
             // Do not allow changes to name but change the alias instead
             if(xrockGui->handleAlias())
             {
-                if (node["name"] != it->second["name"])
+                if (node["name"] != (*current)["name"])
                 {
                     node["alias"] = node["name"];
                 }
                 // TODO: Check that the alias is unique across the whole node map
-                node["name"] = it->second["name"];
+                node["name"] = (*current)["name"];
             }
 
             // Do not allow changes to model
-            node["model"] = it->second["model"];
+            node["model"] = (*current)["model"];
             // Do not allow changes to interface names, change their alias instead
             ConfigVector &inputs = node["inputs"];
             for (size_t i = 0; i < inputs.size(); i++)
             {
-                if (inputs[i]["name"] != it->second["inputs"][i]["name"])
+                if (inputs[i]["name"] != (*current)["inputs"][i]["name"])
                 {
                     inputs[i]["alias"] = inputs[i]["name"];
                 }
-                inputs[i]["name"] = it->second["inputs"][i]["name"];
+                inputs[i]["name"] = (*current)["inputs"][i]["name"];
             }
             ConfigVector &outputs = node["outputs"];
             for (size_t i = 0; i < outputs.size(); i++)
             {
-                if (outputs[i]["name"] != it->second["outputs"][i]["name"])
+                if (outputs[i]["name"] != (*current)["outputs"][i]["name"])
                 {
                     outputs[i]["alias"] = outputs[i]["name"];
                 }
-                outputs[i]["name"] = it->second["outputs"][i]["name"];
+                outputs[i]["name"] = (*current)["outputs"][i]["name"];
             }
             // Update node
-            it->second = node;
+            *current = node;
             return true;
         }
         return false;
@@ -490,10 +488,9 @@ namespace xrock_gui_model
 
     bool ComponentModelInterface::updateEdge(unsigned long edgeId, configmaps::ConfigMap &edge)
     {
-        auto it = edgeMap.find(edgeId);
-        if (it != edgeMap.end())
+        if (edgeMap.contains(edgeId))
         {
-            it->second = edge;
+            edgeMap.set(edgeId, edge);
             return true;
         }
         return false;
@@ -501,28 +498,12 @@ namespace xrock_gui_model
 
     bool ComponentModelInterface::hasNodeInfo(const std::string &type)
     {
-        std::map<std::string, osg_graph_viz::NodeInfo>::iterator it = nodeInfoMap.begin();
-        for (; it != nodeInfoMap.end(); ++it)
-        {
-            if (it->first == type)
-            {
-                return true;
-            }
-        }
-        return false;
+        return typeRegistry->has(type);
     }
 
     configmaps::ConfigMap ComponentModelInterface::getNodeInfo(const std::string &type)
     {
-        std::map<std::string, osg_graph_viz::NodeInfo>::iterator it = nodeInfoMap.begin();
-        for (; it != nodeInfoMap.end(); ++it)
-        {
-            if (it->first == type)
-            {
-                return it->second.map;
-            }
-        }
-        return ConfigMap();
+        return typeRegistry->getMap(type);
     }
 
     bool ComponentModelInterface::registerComponentModel(const std::string &domain, const std::string &name, const std::string &version)
@@ -532,7 +513,6 @@ namespace xrock_gui_model
             return true;
         // Get map from DB. For this we need a reference to the XRockGui
         ConfigMap partModel = xrockGui->db->requestModel(domain, name, version, true);
-        partModels[partType] = partModel;
         // Register the new model
         // NOTE: This function already converts the given basicModel into bagel specific stuff
         if (!addNodeInfo(partType, partModel))
@@ -543,26 +523,59 @@ namespace xrock_gui_model
         return true;
     }
 
+    void ComponentModelInterface::prefetchPartModels(configmaps::ConfigItem &nodes)
+    {
+        std::vector<std::string> partTypes;
+        std::vector<std::tuple<std::string, std::string, std::string>> requests;
+        std::set<std::string> requested;
+        for (auto it : nodes)
+        {
+            const std::string &modelName(it["model"]["name"].getString());
+            const std::string &modelDomain(it["model"]["domain"].getString());
+            const std::string &modelVersion(it["model"]["version"].getString());
+            const std::string &partType(deriveTypeFrom(modelDomain, modelName, modelVersion));
+            if (hasNodeInfo(partType) || !requested.insert(partType).second)
+                continue;
+            partTypes.push_back(partType);
+            requests.push_back(std::make_tuple(modelDomain, modelName, modelVersion));
+        }
+        if (requests.empty())
+            return;
+        std::vector<ConfigMap> partModelList = xrockGui->db->requestModels(requests);
+        bool registered = false;
+        for (size_t i = 0; i < partTypes.size(); ++i)
+        {
+            if (partModelList[i].empty())
+                continue;
+            registered |= addNodeInfo(partTypes[i], partModelList[i]);
+        }
+        if (registered)
+            bagelGui->updateNodeTypes();
+    }
+
     // This function gets called whenever the XRockGui has updates for the current model.
     // E.g. initially the loadComponentModel() function will pass all data to here.
     void ComponentModelInterface::setModelInfo(configmaps::ConfigMap &map)
     {
         // NOTE: basicModel holds the original data. So we just copy over.
-        basicModel = map;
+        // A new map is created, the previous one may still be used by clones of this interface.
+        basicModel = std::make_shared<ConfigMap>(map);
 
         // extract the gui information and store it in separate map
-        if (basicModel["versions"][0].hasKey("data") && basicModel["versions"][0]["data"].hasKey("gui"))
+        if ((*basicModel)["versions"][0].hasKey("data") && (*basicModel)["versions"][0]["data"].hasKey("gui"))
         {
-            guiMap = basicModel["versions"][0]["data"]["gui"];
-            ConfigMap &dataMap = basicModel["versions"][0]["data"];
+            guiMap = (*basicModel)["versions"][0]["data"]["gui"];
+            ConfigMap &dataMap = (*basicModel)["versions"][0]["data"];
             dataMap.erase("gui");
         }
 
         fprintf(stderr, "load nodes...\n");
         // We now use the basic model to setup the GUI
-        if (basicModel["versions"][0].hasKey("components") && basicModel["versions"][0]["components"].hasKey("nodes"))
+        if ((*basicModel)["versions"][0].hasKey("components") && (*basicModel)["versions"][0]["components"].hasKey("nodes"))
         {
-            auto nodes = basicModel["versions"][0]["components"]["nodes"];
+            auto nodes = (*basicModel)["versions"][0]["components"]["nodes"];
+            // Load the models of all unknown parts at once instead of one after the other
+            prefetchPartModels(nodes);
             // At first, we have to create the nodes
             for (auto it : nodes)
             {
@@ -614,15 +627,15 @@ namespace xrock_gui_model
                         }
                     }
                 }
-                BasicModelHelper::updateExportedInterfacesFromModel(currentMap, basicModel, xrockGui->handleAlias());
+                BasicModelHelper::updateExportedInterfacesFromModel(currentMap, *basicModel, xrockGui->handleAlias());
                 bagelGui->updateNodeMap(name, currentMap);
             }
 
             // After we have done the nodes, we can wire their interfaces together
             fprintf(stderr, "load edges...\n");
-            if (basicModel["versions"][0]["components"].hasKey("edges"))
+            if ((*basicModel)["versions"][0]["components"].hasKey("edges"))
             {
-                auto edges = basicModel["versions"][0]["components"]["edges"];
+                auto edges = (*basicModel)["versions"][0]["components"]["edges"];
                 for (auto it : edges)
                 {
                     ConfigMap edge;
@@ -669,11 +682,11 @@ namespace xrock_gui_model
 
             fprintf(stderr, "load configuration...\n");
             // Add configuration update to nodes and edges
-            if (basicModel["versions"][0]["components"].hasKey("configuration"))
+            if ((*basicModel)["versions"][0]["components"].hasKey("configuration"))
             {
-                if (basicModel["versions"][0]["components"]["configuration"].hasKey("nodes"))
+                if ((*basicModel)["versions"][0]["components"]["configuration"].hasKey("nodes"))
                 {
-                    auto nodeConfig = basicModel["versions"][0]["components"]["configuration"]["nodes"];
+                    auto nodeConfig = (*basicModel)["versions"][0]["components"]["configuration"]["nodes"];
                     for (auto it : nodeConfig)
                     {
                         const std::string &nodeName(it["name"].getString());
@@ -695,7 +708,7 @@ namespace xrock_gui_model
 
         fprintf(stderr, "apply part layout...\n");
         // Once we are done creating the nodes, we update their layout
-        applyPartLayout(basicModel);
+        applyPartLayout(*basicModel);
         fprintf(stderr, "...done\n");
     }
 
@@ -716,7 +729,7 @@ namespace xrock_gui_model
     configmaps::ConfigMap &ComponentModelInterface::getModelInfo()
     {
         // NOTE: bagelInfo holds the data which might have been altered.
-        ConfigMap mi(basicModel);
+        ConfigMap mi(*basicModel);
         BasicModelHelper::clearExportedInterfacesInModel(mi);
 
         // NOTE: The toplevel properties have already been updated at this point (see ComponentModelEditorWidget)
@@ -726,7 +739,7 @@ namespace xrock_gui_model
         for (auto &[id, node_] : nodeMap)
         {
             // Update node entry
-            ConfigMap node = *bagelGui->getNodeMap(node_["name"]);
+            ConfigMap node = *bagelGui->getNodeMap((*node_)["name"]);
             ConfigMap n;
             n["name"] = node["name"];
             if (node.hasKey("alias"))
@@ -851,12 +864,12 @@ namespace xrock_gui_model
 
         // When finished, update basicModel and return it
         // NOTE: There might be leftovers of the bagel specific data which will be ignored by the xtype specific data
-        basicModel = mi;
+        basicModel = std::make_shared<ConfigMap>(mi);
 
         // store gui information
         updateCurrentLayout();
-        basicModel["versions"][0]["data"]["gui"] = guiMap;
-        return basicModel;
+        (*basicModel)["versions"][0]["data"]["gui"] = guiMap;
+        return *basicModel;
     }
 
     void ComponentModelInterface::resetConfig(configmaps::ConfigMap &map)
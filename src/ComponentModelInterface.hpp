@@ -6,10 +6,14 @@
 
 #pragma once
 #include <bagel_gui/ModelInterface.hpp>
+#include "utils/CowMap.hpp"
+
+#include <memory>
 
 namespace xrock_gui_model
 {
     class XRockGUI;
+    class ComponentTypeRegistry;
 
     class ComponentModelInterface : public bagel_gui::ModelInterface
     {
@@ -54,6 +58,8 @@ namespace xrock_gui_model
         std::string deriveTypeFrom(const std::string& domain, const std::string& name, const std::string& version);
         std::string deriveTypeFromNodeInfo(configmaps::ConfigMap &model);
         bool addNodeInfo(const std::string& type, configmaps::ConfigMap &model);
+        // Registers a node info map as returned by getNodeInfo(), e.g. from the NodeInfoCache
+        bool restoreNodeInfo(const std::string &type, const configmaps::ConfigMap &map);
         bool hasNodeInfo(const std::string &type);
         configmaps::ConfigMap getNodeInfo(const std::string &type);
 
@@ -64,6 +70,8 @@ namespace xrock_gui_model
         // This function will register a component model if it is not already registered.
         // If the model is unknown it will request it internally
         bool registerComponentModel(const std::string& domain, const std::string& name, const std::string& version);
+        // Requests the models of all parts which are not registered yet with one batch request and registers them
+        void prefetchPartModels(configmaps::ConfigItem &nodes);
         // This function tries to find layout specific info in the given model and will update the layout/positions of the parts
         void applyPartLayout(configmaps::ConfigMap &map);
 
@@ -80,24 +88,23 @@ namespace xrock_gui_model
 
         bool simpleTypeGen;
 
-        std::map<unsigned long, configmaps::ConfigMap> nodeMap;
-        std::map<unsigned long, configmaps::ConfigMap> edgeMap;
+        // Shared with the clones of this interface until one of them changes an entry
+        CowMap<unsigned long, configmaps::ConfigMap> nodeMap;
+        CowMap<unsigned long, configmaps::ConfigMap> edgeMap;
 
-        // Map which holds a mixed and transformed version of the component models of the parts and the part itself (needed to show their interfaces etc.)
+        // Holds a mixed and transformed version of the component models of the parts and the part itself (needed to show their interfaces etc.)
         // it is accessed by an unqiue identifier. The basic model uses domain, name, version keys as a unique identifier.
-        std::map<std::string, osg_graph_viz::NodeInfo> nodeInfoMap;
+        // The registry is shared with all other interfaces (tabs) of the same configuration.
+        std::shared_ptr<ComponentTypeRegistry> typeRegistry;
 
         // This config map should contain the ORIGINAL info of the component model.
         // If this changes the bagel model has to be updated to show the results in the GUI
         // NOTE: The bagel specific stuff based on the basic model is in the node, edge and nodeInfo maps
-        configmaps::ConfigMap basicModel;
+        // The map is shared with the clones of this interface, it is replaced instead of changed once it is set.
+        std::shared_ptr<configmaps::ConfigMap> basicModel;
         // holds information about layouts and gui properties
         configmaps::ConfigMap guiMap;
 
-        // This map stores the ORIGINAL info of the compponent models of the parts.
-        // TODO: This might not be needed anymore, because we store the complete model in the nodeInfoMap as well.
-        std::map<std::string, configmaps::ConfigMap> partModels;
-
         void loadNodeInfo(std::string path, bool orogen = false); // NOTE: Needed for bagel/shader stuff. Could be moved to XRockGui itself
         bool addOrogenInfo(configmaps::ConfigMap &model); // DEPRECATED
 
@@ -0,0 +1,56 @@
+/**
+ * \file ComponentTypeRegistry.cpp
+ * \brief Node infos of the component types, shared by all model interfaces of a configuration
+ **/
+
+#include "ComponentTypeRegistry.hpp"
+
+using namespace configmaps;
+
+namespace xrock_gui_model
+{
+
+    std::shared_ptr<ComponentTypeRegistry> ComponentTypeRegistry::getShared(const std::string &key)
+    {
+        static std::mutex registriesMutex;
+        static std::map<std::string, std::weak_ptr<ComponentTypeRegistry>> registries;
+        std::lock_guard<std::mutex> lock(registriesMutex);
+        std::shared_ptr<ComponentTypeRegistry> registry = registries[key].lock();
+        if (!registry)
+        {
+            registry = std::make_shared<ComponentTypeRegistry>();
+            registries[key] = registry;
+        }
+        return registry;
+    }
+
+    bool ComponentTypeRegistry::add(const osg_graph_viz::NodeInfo &info)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return infos.emplace(info.type, info).second;
+    }
+
+    bool ComponentTypeRegistry::has(const std::string &type) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return infos.find(type) != infos.end();
+    }
+
+    ConfigMap ComponentTypeRegistry::getMap(const std::string &type) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = infos.find(type);
+        if (it == infos.end())
+        {
+            return ConfigMap();
+        }
+        return it->second.map;
+    }
+
+    size_t ComponentTypeRegistry::size() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return infos.size();
+    }
+
+} // end of namespace xrock_gui_model
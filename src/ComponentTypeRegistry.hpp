@@ -0,0 +1,46 @@
+/**
+ * \file ComponentTypeRegistry.hpp
+ * \brief Node infos of the component types, shared by all model interfaces of a configuration
+ **/
+
+#pragma once
+#include <configmaps/ConfigMap.hpp>
+#include <osg_graph_viz/Node.hpp>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace xrock_gui_model
+{
+
+    /**
+     * @brief Registry of the node infos of all component types known to the model interfaces.
+     *
+     * Every ComponentModelInterface (one per tab) only holds a handle to the
+     * registry of its configuration, so a type is kept once, however many tabs
+     * use it. An entry is never changed or removed once it is added. The
+     * registry is destroyed with the last handle.
+     */
+    class ComponentTypeRegistry
+    {
+    public:
+        // Registry of all interfaces using the same key (their config directory), created on first use
+        static std::shared_ptr<ComponentTypeRegistry> getShared(const std::string &key);
+
+        // Adds the info unless its type is known already. Thread-safe.
+        bool add(const osg_graph_viz::NodeInfo &info);
+        bool has(const std::string &type) const;
+        // Info map of the type, empty if the type is unknown. Thread-safe.
+        configmaps::ConfigMap getMap(const std::string &type) const;
+        // All entries; to be used on the GUI thread while no other thread adds types
+        const std::map<std::string, osg_graph_viz::NodeInfo> &getAll() const { return infos; }
+        size_t size() const;
+
+    private:
+        mutable std::mutex mutex;
+        std::map<std::string, osg_graph_viz::NodeInfo> infos;
+    };
+
+} // end of namespace xrock_gui_model
@@ -6,6 +6,8 @@
 
 #pragma once
 #include <configmaps/ConfigMap.hpp>
+#include "LazyModel.hpp"
+#include <tuple>
 #if __has_include(<filesystem>)
     #include <filesystem>
     namespace fs = std::filesystem;
@@ -22,6 +24,9 @@ namespace xrock_gui_model
     class DBInterface
     {
     public:
+        // domain is empty if the backend does not know it; an empty model means that any model may have changed
+        typedef std::function<void(const std::string &domain, const std::string &model)> ChangeListener;
+
         DBInterface() = default;
         virtual ~DBInterface() = default;
 
@@ -61,6 +66,96 @@ namespace xrock_gui_model
                                                    const std::string &model,
                                                    const std::string &version,
                                                    const bool limit = false) = 0;
+
+        /**
+         * @brief Requests all versions of a model without loading their content.
+         *
+         * Only the version names are fetched up front. The content of a version is
+         * requested when it is accessed through the returned LazyModel. Use this instead
+         * of requestModel(domain, model, version, false) if not every version is needed.
+         * The default implementation uses requestVersions() and requestModel(..., true).
+         *
+         * @param domain The domain where the model is located.
+         * @param model The name of the model to retrieve.
+         * @return A LazyModel holding the versions of the model.
+         */
+        virtual LazyModel requestModelLazy(const std::string &domain, const std::string &model)
+        {
+            return LazyModel(requestVersions(domain, model),
+                             [this, domain, model](const std::string &version)
+                             { return requestModel(domain, model, version, true); });
+        }
+
+        /**
+         * @brief Requests several models with a specific version at once.
+         *
+         * Each request is a tuple of domain, model name and version. The result holds
+         * one map per request in the same order, in the format of
+         * requestModel(domain, model, version, true). Models which could not be found
+         * are returned as empty maps. The default implementation calls requestModel()
+         * for each request; backends should override it to save round trips.
+         *
+         * @param models The domain, name and version of each requested model.
+         * @return A vector of ConfigMap objects containing the requested models.
+         */
+        virtual std::vector<configmaps::ConfigMap> requestModels(const std::vector<std::tuple<std::string, std::string, std::string>> &models)
+        {
+            std::vector<configmaps::ConfigMap> result;
+            result.reserve(models.size());
+            for (const auto &it : models)
+            {
+                result.push_back(requestModel(std::get<0>(it), std::get<1>(it), std::get<2>(it), true));
+            }
+            return result;
+        }
+
+        /**
+         * @brief Requests the model versions which use a model as component.
+         *
+         * A model version uses another model if one of the nodes in
+         * versions[].components.nodes[] references it by its model entry.
+         * The default implementation loads every version of every model;
+         * backends should override it with an index.
+         *
+         * @param domain The domain of the used model, an empty domain matches any domain.
+         * @param model The name of the used model.
+         * @param version The version of the used model, an empty version matches any version.
+         * @return The domain, name and version of each model version using the model.
+         */
+        virtual std::vector<std::tuple<std::string, std::string, std::string>> requestDependents(const std::string &domain,
+                                                                                                const std::string &model,
+                                                                                                const std::string &version)
+        {
+            std::vector<std::tuple<std::string, std::string, std::string>> result;
+            for (const auto &domainName : getDomains())
+            {
+                for (const auto &entry : requestModelListByDomain(domainName))
+                {
+                    for (const auto &versionName : requestVersions(domainName, entry.first))
+                    {
+                        configmaps::ConfigMap map = requestModel(domainName, entry.first, versionName, true);
+                        if (!map.hasKey("versions") || map["versions"].size() == 0 ||
+                            !map["versions"][0].hasKey("components") ||
+                            !map["versions"][0]["components"].hasKey("nodes"))
+                        {
+                            continue;
+                        }
+                        for (auto &node : map["versions"][0]["components"]["nodes"])
+                        {
+                            if (node.hasKey("model") && node["model"]["name"].getString() == model &&
+                                (domain.empty() || node["model"]["domain"].getString() == domain) &&
+                                (version.empty() || node["model"]["version"].getString() == version))
+                            {
+                                result.emplace_back(domainName, entry.first, versionName);
+                                break;
+                            }
+                        }
+                    }
+                }
+            }
+            return result;
+        }
+
         /**
         * @brief Stores a model in the database.
         *
@@ -114,6 +209,23 @@ namespace xrock_gui_model
          */
         virtual bool isConnected() { return false; };
 
+        /**
+         * @brief Registers a function which is called when models of the database change.
+         *
+         * Backends which can observe their storage report changes, including the ones
+         * made by other processes. The listener is called from a background thread and
+         * has to pass the notification on to the thread which uses the database.
+         *
+         * @param listener The function to call with the domain and name of a changed model.
+         * @return An id for removeChangeListener() or -1 if the backend does not report changes.
+         */
+        virtual int addChangeListener(ChangeListener listener) { return -1; };
+
+        /**
+         * @brief Removes a listener. Once this returns, the listener is not called anymore.
+         */
+        virtual void removeChangeListener(int id) {};
+
         /**
          * @brief Retrieves a map of the default properties of a component model.
          */
@@ -0,0 +1,550 @@
+/**
+ * \file FederatedDB.cpp
+ * \brief Combines several database backends as configured for a MultiDbClient
+ **/
+
+#include "FederatedDB.hpp"
+#include "FileDB.hpp"
+#include "SQLiteDB.hpp"
+#include "utils/ThreadPool.hpp"
+
+#include <configmaps/ConfigVector.hpp>
+
+#include <future>
+#include <iostream>
+#include <set>
+#include <QCoreApplication>
+#include <QMessageBox>
+#include <QThread>
+using namespace configmaps;
+
+namespace xrock_gui_model
+{
+
+    namespace
+    {
+        std::string getString(ConfigMap &map, const std::string &key)
+        {
+            std::string value = map.hasKey(key) ? map[key].getString() : std::string("");
+            // MultiDBConfig.yml files are edited by hand
+            const size_t begin = value.find_first_not_of(" \t");
+            const size_t end = value.find_last_not_of(" \t");
+            return begin == std::string::npos ? std::string("") : value.substr(begin, end - begin + 1);
+        }
+
+        bool isLocalType(const std::string &type)
+        {
+            return type == "FileDB" || type == "SQLite";
+        }
+
+        // path of a local server, relative paths are taken relative to the directory of the config
+        fs::path getServerPath(ConfigMap &server, const std::string &basePath)
+        {
+            fs::path path = getString(server, "path");
+            if (!path.empty() && path.is_relative() && !basePath.empty())
+            {
+                path = fs::path(basePath) / path;
+            }
+            return path;
+        }
+
+        // identifies a server independent of its name and of how its path is written
+        std::string getServerKey(ConfigMap &server, const std::string &basePath)
+        {
+            // "." and ".." are dropped by hand, not all filesystem implementations provide lexically_normal()
+            std::vector<std::string> parts;
+            for (const auto &element : getServerPath(server, basePath))
+            {
+                const std::string part = element.string();
+                if (part.empty() || part == ".")
+                {
+                    continue;
+                }
+                if (part == ".." && !parts.empty() && parts.back() != ".." && parts.back() != "/")
+                {
+                    parts.pop_back();
+                }
+                else
+                {
+                    parts.push_back(part);
+                }
+            }
+            std::string path;
+            for (const auto &part : parts)
+            {
+                path += path.empty() || path.back() == '/' ? part : "/" + part;
+            }
+            return getString(server, "type") + "\n" + path + "\n" +
+                   getString(server, "url") + "\n" + getString(server, "graph");
+        }
+
+        // Requests only the versions the backend has, backends warn about missing ones
+        std::vector<ConfigMap> requestExisting(DBInterface &db, const std::vector<std::tuple<std::string, std::string, std::string>> &models)
+        {
+            std::map<std::pair<std::string, std::string>, std::set<std::string>> versions;
+            std::vector<std::tuple<std::string, std::string, std::string>> requests;
+            std::vector<size_t> positions;
+            for (size_t i = 0; i < models.size(); ++i)
+            {
+                const auto key = std::make_pair(std::get<0>(models[i]), std::get<1>(models[i]));
+                auto it = versions.find(key);
+                if (it == versions.end())
+                {
+                    const std::vector<std::string> list = db.requestVersions(key.first, key.second);
+                    it = versions.emplace(key, std::set<std::string>(list.begin(), list.end())).first;
+                }
+                if (it->second.count(std::get<2>(models[i])))
+                {
+                    requests.push_back(models[i]);
+                    positions.push_back(i);
+                }
+            }
+            std::vector<ConfigMap> result(models.size());
+            if (!requests.empty())
+            {
+                std::vector<ConfigMap> loaded = db.requestModels(requests);
+                for (size_t i = 0; i < positions.size() && i < loaded.size(); ++i)
+                {
+                    result[positions[i]] = std::move(loaded[i]);
+                }
+            }
+            return result;
+        }
+    }
+
+    FederatedDB::FederatedDB() : mainBackend(-1), nextListenerId(0)
+    {
+    }
+
+    FederatedDB::~FederatedDB()
+    {
+        // running requests still use the backends
+        pool.reset();
+        std::lock_guard<std::mutex> lock(listenerMutex);
+        for (const auto &it : listenerIds)
+        {
+            for (const auto &backendId : it.second)
+            {
+                std::lock_guard<std::recursive_mutex> backendLock(*backends[backendId.first].mutex);
+                backends[backendId.first].db->removeChangeListener(backendId.second);
+            }
+        }
+    }
+
+    void FederatedDB::warn(const std::string &message)
+    {
+        QCoreApplication *app = QCoreApplication::instance();
+        if (app && QThread::currentThread() == app->thread())
+        {
+            QMessageBox::warning(nullptr, "Warning", QString::fromStdString(message), QMessageBox::Ok);
+        }
+        else
+        {
+            std::cerr << "FederatedDB: " << message << std::endl;
+        }
+    }
+
+    DBInterface *FederatedDB::createLocalBackend(const ConfigMap &server_, const std::string &basePath)
+    {
+        ConfigMap server = server_;
+        const std::string type = getString(server, "type");
+        const fs::path path = getServerPath(server, basePath);
+        if (!isLocalType(type) || path.empty())
+        {
+            return nullptr;
+        }
+        if (type == "SQLite")
+        {
+            SQLiteDB *db = new SQLiteDB();
+            db->setDbAddress(path.string());
+            return db;
+        }
+        FileDB *db = new FileDB();
+        db->setDbAddress(path.string());
+        return db;
+    }
+
+    bool FederatedDB::hasLocalServers(const ConfigMap &config_)
+    {
+        ConfigMap config = config_;
+        if (config.hasKey("main_server") && isLocalType(getString(config["main_server"], "type")))
+        {
+            return true;
+        }
+        if (config.hasKey("import_servers"))
+        {
+            for (auto &server : config["import_servers"])
+            {
+                if (isLocalType(getString(server, "type")))
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    bool FederatedDB::loadConfig(const ConfigMap &config_, const std::string &basePath, BackendFactory factory)
+    {
+        ConfigMap config = config_;
+        auto create = [&](ConfigMap &server) -> DBInterface *
+        {
+            const fs::path path = getServerPath(server, basePath);
+            if (!path.empty())
+            {
+                server["path"] = path.string();
+            }
+            DBInterface *db = factory ? factory(server) : createLocalBackend(server, basePath);
+            if (!db)
+            {
+                warn("cannot use the " + getString(server, "type") + " server " + getString(server, "name") +
+                     " (" + getString(server, "path") + getString(server, "url") + ")");
+            }
+            return db;
+        };
+        std::string mainKey;
+        if (config.hasKey("main_server"))
+        {
+            ConfigMap &server = config["main_server"];
+            if (DBInterface *db = create(server))
+            {
+                mainKey = getServerKey(server, basePath);
+                addBackend(getString(server, "name"), db, false, true);
+            }
+        }
+        if (config.hasKey("import_servers"))
+        {
+            for (auto &item : config["import_servers"])
+            {
+                ConfigMap &server = item;
+                if (mainBackend >= 0 && getServerKey(server, basePath) == mainKey)
+                {
+                    // "Also lookup in Main Server" repeats the main server under another name
+                    lookups.push_back(mainBackend);
+                    pool.reset(new ThreadPool(lookups.size()));
+                }
+                else if (DBInterface *db = create(server))
+                {
+                    addBackend(getString(server, "name"), db, true, false);
+                }
+            }
+        }
+        return mainBackend >= 0 && !lookups.empty();
+    }
+
+    void FederatedDB::addBackend(const std::string &name, DBInterface *backend, bool lookup, bool main)
+    {
+        backends.push_back(Backend{name, std::unique_ptr<DBInterface>(backend), std::unique_ptr<std::recursive_mutex>(new std::recursive_mutex())});
+        if (lookup)
+        {
+            lookups.push_back(backends.size() - 1);
+            pool.reset(new ThreadPool(lookups.size()));
+        }
+        if (main)
+        {
+            mainBackend = backends.size() - 1;
+        }
+    }
+
+    int FederatedDB::getMain() const
+    {
+        if (mainBackend >= 0)
+        {
+            return mainBackend;
+        }
+        return backends.empty() ? -1 : 0;
+    }
+
+    template <typename Result>
+    Result FederatedDB::callBackend(size_t index, const std::function<Result(DBInterface &)> &request)
+    {
+        std::lock_guard<std::recursive_mutex> lock(*backends[index].mutex);
+        return request(*backends[index].db);
+    }
+
+    template <typename Result>
+    std::vector<Result> FederatedDB::fanOut(const std::function<Result(DBInterface &)> &request)
+    {
+        std::vector<Result> results(lookups.size());
+        if (lookups.size() == 1)
+        {
+            results[0] = callBackend(lookups[0], request);
+            return results;
+        }
+        if (!lookups.empty())
+        {
+            pool->parallelFor(lookups.size(), [&](size_t i)
+                              { results[i] = callBackend(lookups[i], request); });
+        }
+        return results;
+    }
+
+    template <typename Result>
+    Result FederatedDB::findFirst(const std::function<Result(DBInterface &)> &request,
+                                  const std::function<bool(const Result &)> &found)
+    {
+        if (lookups.size() == 1)
+        {
+            Result result = callBackend(lookups[0], request);
+            return found(result) ? result : Result();
+        }
+        // the tasks own copies of the request, so the slower backends may finish after a hit was returned
+        std::vector<std::future<Result>> running;
+        running.reserve(lookups.size());
+        for (size_t index : lookups)
+        {
+            running.push_back(pool->submit([this, index, request]
+                                           { return callBackend(index, request); }));
+        }
+        for (auto &future : running)
+        {
+            Result result = future.get();
+            if (found(result))
+            {
+                return result;
+            }
+        }
+        return Result();
+    }
+
+    std::vector<std::pair<std::string, std::string>> FederatedDB::requestModelListByDomain(const std::string &domain)
+    {
+        typedef std::vector<std::pair<std::string, std::string>> ModelList;
+        std::vector<ModelList> lists = fanOut<ModelList>([domain](DBInterface &db)
+                                                         { return db.requestModelListByDomain(domain); });
+        ModelList modelList;
+        std::set<std::string> known;
+        for (const auto &list : lists)
+        {
+            for (const auto &entry : list)
+            {
+                if (known.insert(entry.first).second)
+                {
+                    modelList.push_back(entry);
+                }
+            }
+        }
+        return modelList;
+    }
+
+    std::vector<std::string> FederatedDB::requestVersions(const std::string &domain, const std::string &model)
+    {
+        typedef std::vector<std::string> VersionList;
+        std::vector<VersionList> lists = fanOut<VersionList>([domain, model](DBInterface &db)
+                                                             { return db.requestVersions(domain, model); });
+        VersionList versions;
+        std::set<std::string> known;
+        for (const auto &list : lists)
+        {
+            for (const auto &version : list)
+            {
+                if (known.insert(version).second)
+                {
+                    versions.push_back(version);
+                }
+            }
+        }
+        return versions;
+    }
+
+    ConfigMap FederatedDB::requestModel(const std::string &domain,
+                                        const std::string &model,
+                                        const std::string &version,
+                                        const bool limit)
+    {
+        if (!limit)
+        {
+            return requestModelLazy(domain, model).toConfigMap();
+        }
+        const std::vector<std::tuple<std::string, std::string, std::string>> request = {std::make_tuple(domain, model, version)};
+        return findFirst<ConfigMap>([request](DBInterface &db)
+                                    { return requestExisting(db, request)[0]; },
+                                    [](const ConfigMap &map)
+                                    { return !map.empty(); });
+    }
+
+    LazyModel FederatedDB::requestModelLazy(const std::string &domain, const std::string &model)
+    {
+        return LazyModel(
+            requestVersions(domain, model),
+            [this, domain, model](const std::string &version)
+            { return requestModel(domain, model, version, true); },
+            [this, domain, model](const std::vector<std::string> &versions)
+            {
+                std::vector<std::tuple<std::string, std::string, std::string>> requests;
+                for (const auto &version : versions)
+                {
+                    requests.emplace_back(domain, model, version);
+                }
+                return requestModels(requests);
+            });
+    }
+
+    std::vector<ConfigMap> FederatedDB::requestModels(const std::vector<std::tuple<std::string, std::string, std::string>> &models)
+    {
+        std::vector<std::vector<ConfigMap>> batches = fanOut<std::vector<ConfigMap>>([&models](DBInterface &db)
+                                                                                     { return requestExisting(db, models); });
+        std::vector<ConfigMap> result(models.size());
+        for (size_t i = 0; i < models.size(); ++i)
+        {
+            for (auto &batch : batches)
+            {
+                if (i < batch.size() && !batch[i].empty())
+                {
+                    result[i] = std::move(batch[i]);
+                    break;
+                }
+            }
+        }
+        return result;
+    }
+
+    std::vector<std::tuple<std::string, std::string, std::string>> FederatedDB::requestDependents(const std::string &domain,
+                                                                                                 const std::string &model,
+                                                                                                 const std::string &version)
+    {
+        typedef std::vector<std::tuple<std::string, std::string, std::string>> DependentList;
+        std::vector<DependentList> lists = fanOut<DependentList>([domain, model, version](DBInterface &db)
+                                                                 { return db.requestDependents(domain, model, version); });
+        DependentList dependents;
+        std::set<std::tuple<std::string, std::string, std::string>> known;
+        for (const auto &list : lists)
+        {
+            for (const auto &dependent : list)
+            {
+                if (known.insert(dependent).second)
+                {
+                    dependents.push_back(dependent);
+                }
+            }
+        }
+        return dependents;
+    }
+
+    bool FederatedDB::storeModel(const ConfigMap &map)
+    {
+        const int main = getMain();
+        if (main < 0)
+        {
+            warn("no main server configured");
+            return false;
+        }
+        return callBackend<bool>(main, [&map](DBInterface &db)
+                                 { return db.storeModel(map); });
+    }
+
+    bool FederatedDB::removeModel(const std::string &uri)
+    {
+        const int main = getMain();
+        return main >= 0 && callBackend<bool>(main, [&uri](DBInterface &db)
+                                              { return db.removeModel(uri); });
+    }
+
+    int FederatedDB::addChangeListener(ChangeListener listener)
+    {
+        std::lock_guard<std::mutex> lock(listenerMutex);
+        std::vector<std::pair<size_t, int>> ids;
+        for (size_t i = 0; i < backends.size(); ++i)
+        {
+            const int id = callBackend<int>(i, [&listener](DBInterface &db)
+                                            { return db.addChangeListener(listener); });
+            if (id >= 0)
+            {
+                ids.emplace_back(i, id);
+            }
+        }
+        if (ids.empty())
+        {
+            return -1;
+        }
+        listenerIds[nextListenerId] = ids;
+        return nextListenerId++;
+    }
+
+    void FederatedDB::removeChangeListener(int id)
+    {
+        std::lock_guard<std::mutex> lock(listenerMutex);
+        auto it = listenerIds.find(id);
+        if (it == listenerIds.end())
+        {
+            return;
+        }
+        for (const auto &backendId : it->second)
+        {
+            std::lock_guard<std::recursive_mutex> backendLock(*backends[backendId.first].mutex);
+            backends[backendId.first].db->removeChangeListener(backendId.second);
+        }
+        listenerIds.erase(it);
+    }
+
+    ConfigMap FederatedDB::getPropertiesOfComponentModel()
+    {
+        const int main = getMain();
+        return main < 0 ? ConfigMap() : callBackend<ConfigMap>(main, [](DBInterface &db)
+                                                               { return db.getPropertiesOfComponentModel(); });
+    }
+
+    std::vector<std::string> FederatedDB::getDomains()
+    {
+        typedef std::vector<std::string> DomainList;
+        std::vector<DomainList> lists = fanOut<DomainList>([](DBInterface &db)
+                                                           { return db.getDomains(); });
+        DomainList domains;
+        std::set<std::string> known;
+        for (const auto &list : lists)
+        {
+            for (const auto &domain : list)
+            {
+                if (known.insert(domain).second)
+                {
+                    domains.push_back(domain);
+                }
+            }
+        }
+        return domains;
+    }
+
+    ConfigMap FederatedDB::getEmptyComponentModel()
+    {
+        const int main = getMain();
+        return main < 0 ? ConfigMap() : callBackend<ConfigMap>(main, [](DBInterface &db)
+                                                               { return db.getEmptyComponentModel(); });
+    }
+
+    bool FederatedDB::buildModule(const std::string &uri, const std::string &moduleName, const std::map<std::string, std::string> &selected_implementations)
+    {
+        // the module is a new model, which is stored in the main server
+        const int main = getMain();
+        return main >= 0 && callBackend<bool>(main, [&](DBInterface &db)
+                                              { return db.buildModule(uri, moduleName, selected_implementations); });
+    }
+
+    ConfigMap FederatedDB::getUnresolvedAbstracts(const std::string &uri)
+    {
+        const int main = getMain();
+        if (main < 0)
+        {
+            return ConfigMap();
+        }
+        const std::function<ConfigMap(DBInterface &)> request = [&uri](DBInterface &db)
+        { return db.getUnresolvedAbstracts(uri); };
+        ConfigMap result = callBackend(main, request);
+        for (size_t index : lookups)
+        {
+            if (result.hasKey("unresolved_abstracts") && result["unresolved_abstracts"].size() > 0)
+            {
+                break;
+            }
+            if ((int)index != main)
+            {
+                ConfigMap other = callBackend(index, request);
+                if (other.hasKey("unresolved_abstracts") && other["unresolved_abstracts"].size() > 0)
+                {
+                    result = other;
+                }
+            }
+        }
+        return result;
+    }
+
+} // end of namespace xrock_gui_model
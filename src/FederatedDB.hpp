@@ -0,0 +1,118 @@
+/**
+ * \file FederatedDB.hpp
+ * \brief Combines several database backends as configured for a MultiDbClient
+ **/
+
+#pragma once
+#include <configmaps/ConfigMap.hpp>
+#include "DBInterface.hpp"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace xrock_gui_model
+{
+    class ThreadPool;
+
+    /**
+     * @brief DBInterface combining several backends as configured in MultiDBConfig.yml.
+     *
+     * The backends of import_servers are the lookup backends, in the order of
+     * their priority. A request is sent to all of them in parallel; the result of
+     * the first backend in priority order which has the model wins. Lists of
+     * models, versions, domains and dependents are merged, entries of backends
+     * with a higher priority come first. Models are stored to and removed from the
+     * main_server. It is only looked up if import_servers names it as well (same
+     * type and path), as the MultiDBConfigDialog does for "Also lookup in Main Server".
+     */
+    class FederatedDB : public DBInterface
+    {
+    public:
+        // Creates the backend of one server entry ({type, path, url, graph}) or returns null if the type is not supported
+        typedef std::function<DBInterface *(const configmaps::ConfigMap &server)> BackendFactory;
+
+        FederatedDB();
+        ~FederatedDB();
+
+        // Creates the backends of a MultiDBConfig.yml. Relative paths are taken relative to basePath,
+        // the factory gets the entries with the resolved path. Without a factory only FileDB and SQLite
+        // servers are supported. Servers whose backend cannot be created are skipped with a warning.
+        bool loadConfig(const configmaps::ConfigMap &config, const std::string &basePath,
+                        BackendFactory factory = BackendFactory());
+        // Backend of a FileDB or SQLite server entry, null for other types
+        static DBInterface *createLocalBackend(const configmaps::ConfigMap &server, const std::string &basePath);
+        // True if a server of the config is a FileDB or SQLite, which the xrock_io_library does not provide
+        static bool hasLocalServers(const configmaps::ConfigMap &config);
+
+        // Takes ownership of backend. lookup: the backend is asked by requests, after the ones added before.
+        // main: models are stored in this backend.
+        void addBackend(const std::string &name, DBInterface *backend, bool lookup, bool main);
+        size_t getNumBackends() const { return backends.size(); }
+
+        std::vector<std::pair<std::string, std::string>> requestModelListByDomain(const std::string &domain) override;
+        std::vector<std::string> requestVersions(const std::string &domain, const std::string &model) override;
+        configmaps::ConfigMap requestModel(const std::string &domain,
+                                           const std::string &model,
+                                           const std::string &version,
+                                           const bool limit = false) override;
+        LazyModel requestModelLazy(const std::string &domain, const std::string &model) override;
+        // Every lookup backend gets the part of the batch it has, each map is taken from the first backend having it
+        std::vector<configmaps::ConfigMap> requestModels(const std::vector<std::tuple<std::string, std::string, std::string>> &models) override;
+        std::vector<std::tuple<std::string, std::string, std::string>> requestDependents(const std::string &domain,
+                                                                                        const std::string &model,
+                                                                                        const std::string &version) override;
+        bool storeModel(const configmaps::ConfigMap &map) override;
+        bool removeModel(const std::string &uri) override;
+        // The backends are configured by loadConfig()
+        bool isConnected() override { return !backends.empty(); }
+        int addChangeListener(ChangeListener listener) override;
+        void removeChangeListener(int id) override;
+        configmaps::ConfigMap getPropertiesOfComponentModel() override;
+        std::vector<std::string> getDomains() override;
+        configmaps::ConfigMap getEmptyComponentModel() override;
+        bool buildModule(const std::string &uri, const std::string &moduleName, const std::map<std::string, std::string> &selected_implementations) override;
+        // Asked from the main backend on, the first backend knowing abstracts of the model answers
+        configmaps::ConfigMap getUnresolvedAbstracts(const std::string &uri) override;
+
+    private:
+        struct Backend
+        {
+            std::string name;
+            std::unique_ptr<DBInterface> db;
+            // held around every call of db, the tasks of findFirst() may still run after it returned
+            std::unique_ptr<std::recursive_mutex> mutex;
+        };
+
+        std::vector<Backend> backends;
+        // indices into backends in the order of their priority
+        std::vector<size_t> lookups;
+        // index of the main backend or -1
+        int mainBackend;
+        // index of the backend and id of the listener in it
+        std::map<int, std::vector<std::pair<size_t, int>>> listenerIds;
+        int nextListenerId;
+        std::mutex listenerMutex;
+        // one thread per lookup backend, destroyed before the backends it calls
+        std::unique_ptr<ThreadPool> pool;
+
+        static void warn(const std::string &message);
+        // index of the main backend, or of the first backend if there is no main one; -1 without backends
+        int getMain() const;
+        // Calls request for the backend at index while holding its lock
+        template <typename Result>
+        Result callBackend(size_t index, const std::function<Result(DBInterface &)> &request);
+        // Calls request for every lookup backend in parallel, the results are in priority order
+        template <typename Result>
+        std::vector<Result> fanOut(const std::function<Result(DBInterface &)> &request);
+        // Calls request for the lookup backends in parallel and returns the first result
+        // in priority order for which found is true, or an empty result
+        template <typename Result>
+        Result findFirst(const std::function<Result(DBInterface &)> &request,
+                         const std::function<bool(const Result &)> &found);
+    };
+
+} // end of namespace xrock_gui_model
@@ -0,0 +1,188 @@
+/**
+ * \file FileCompression.cpp
+ * \brief Compression of the files of a FileDB, detected by their extension
+ **/
+
+#include "FileCompression.hpp"
+
+#include <zlib.h>
+#ifdef XROCK_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace xrock_gui_model
+{
+
+    namespace
+    {
+        bool hasSuffix(const std::string &text, const std::string &suffix)
+        {
+            return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+        }
+
+        // windowBits of zlib selecting the gzip header, plus automatic header detection when inflating
+        const int gzipWindowBits = 15 + 16;
+        const int detectWindowBits = 15 + 32;
+    }
+
+    std::string FileCompression::getExtension(Format format)
+    {
+        switch (format)
+        {
+        case GZIP:
+            return ".gz";
+        case ZSTD:
+            return ".zst";
+        default:
+            return "";
+        }
+    }
+
+    FileCompression::Format FileCompression::getFormat(const std::string &file)
+    {
+        if (hasSuffix(file, ".gz"))
+        {
+            return GZIP;
+        }
+        if (hasSuffix(file, ".zst"))
+        {
+            return ZSTD;
+        }
+        return NONE;
+    }
+
+    bool FileCompression::parseFormat(const std::string &name, Format *format)
+    {
+        if (name == "none" || name.empty())
+        {
+            *format = NONE;
+        }
+        else if (name == "gzip" || name == "zlib")
+        {
+            *format = GZIP;
+        }
+        else if (name == "zstd")
+        {
+            *format = ZSTD;
+        }
+        else
+        {
+            return false;
+        }
+        return true;
+    }
+
+    bool FileCompression::isSupported(Format format)
+    {
+#ifdef XROCK_HAVE_ZSTD
+        return true;
+#else
+        return format != ZSTD;
+#endif
+    }
+
+    bool FileCompression::compress(Format format, const std::string &data, std::string *result)
+    {
+        if (format == NONE)
+        {
+            *result = data;
+            return true;
+        }
+        if (format == GZIP)
+        {
+            z_stream stream = {};
+            if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, gzipWindowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            {
+                return false;
+            }
+            result->resize(deflateBound(&stream, data.size()));
+            stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+            stream.avail_in = data.size();
+            stream.next_out = reinterpret_cast<Bytef *>(&(*result)[0]);
+            stream.avail_out = result->size();
+            int status = deflate(&stream, Z_FINISH);
+            result->resize(stream.total_out);
+            deflateEnd(&stream);
+            return status == Z_STREAM_END;
+        }
+#ifdef XROCK_HAVE_ZSTD
+        result->resize(ZSTD_compressBound(data.size()));
+        size_t size = ZSTD_compress(&(*result)[0], result->size(), data.data(), data.size(), 3);
+        if (ZSTD_isError(size))
+        {
+            return false;
+        }
+        result->resize(size);
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    bool FileCompression::decompress(Format format, const std::string &data, std::string *result, std::string *error)
+    {
+        if (format == NONE)
+        {
+            *result = data;
+            return true;
+        }
+        char buffer[65536];
+        result->clear();
+        if (format == GZIP)
+        {
+            z_stream stream = {};
+            if (inflateInit2(&stream, detectWindowBits) != Z_OK)
+            {
+                *error = "could not initialize zlib";
+                return false;
+            }
+            stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+            stream.avail_in = data.size();
+            int status;
+            do
+            {
+                stream.next_out = reinterpret_cast<Bytef *>(buffer);
+                stream.avail_out = sizeof(buffer);
+                status = inflate(&stream, Z_NO_FLUSH);
+                result->append(buffer, sizeof(buffer) - stream.avail_out);
+            } while (status == Z_OK);
+            inflateEnd(&stream);
+            if (status != Z_STREAM_END)
+            {
+                *error = "invalid gzip data";
+                return false;
+            }
+            return true;
+        }
+#ifdef XROCK_HAVE_ZSTD
+        ZSTD_DStream *stream = ZSTD_createDStream();
+        ZSTD_initDStream(stream);
+        ZSTD_inBuffer in = {data.data(), data.size(), 0};
+        size_t status = 0;
+        bool flushing;
+        do
+        {
+            ZSTD_outBuffer out = {buffer, sizeof(buffer), 0};
+            status = ZSTD_decompressStream(stream, &out, &in);
+            if (ZSTD_isError(status))
+            {
+                break;
+            }
+            result->append(buffer, out.pos);
+            // a full buffer may leave decompressed data behind
+            flushing = out.pos == out.size && status != 0;
+        } while (in.pos < in.size || flushing);
+        ZSTD_freeDStream(stream);
+        if (ZSTD_isError(status) || status != 0)
+        {
+            *error = "invalid zstd data";
+            return false;
+        }
+        return true;
+#else
+        *error = "built without zstd support";
+        return false;
+#endif
+    }
+
+} // end of namespace xrock_gui_model
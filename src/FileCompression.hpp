@@ -0,0 +1,38 @@
+/**
+ * \file FileCompression.hpp
+ * \brief Compression of the files of a FileDB, detected by their extension
+ **/
+
+#pragma once
+#include <string>
+
+namespace xrock_gui_model
+{
+
+    /**
+     * @brief gzip (zlib) and, if built with XROCK_HAVE_ZSTD, zstd compression of whole files.
+     *
+     * The format of a file is given by its extension: ".gz", ".zst" or none.
+     */
+    class FileCompression
+    {
+    public:
+        enum Format
+        {
+            NONE,
+            GZIP,
+            ZSTD
+        };
+
+        // Extension including the dot, empty for NONE
+        static std::string getExtension(Format format);
+        static Format getFormat(const std::string &file);
+        // Parses "none", "gzip" or "zstd"
+        static bool parseFormat(const std::string &name, Format *format);
+        static bool isSupported(Format format);
+
+        static bool compress(Format format, const std::string &data, std::string *result);
+        static bool decompress(Format format, const std::string &data, std::string *result, std::string *error);
+    };
+
+} // end of namespace xrock_gui_model
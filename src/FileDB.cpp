@@ -1,218 +1,2614 @@
 #include "FileDB.hpp"
 #include "BasicModelHelper.hpp"
+#include "FileCompression.hpp"
+#include "ModelDelta.hpp"
+#include "utils/ThreadPool.hpp"
 
 #include <mars/utils/misc.h>
 #include <configmaps/ConfigVector.hpp>
 
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <map>
 #include <ctime>
-#include<QMessageBox>
+#include <thread>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <QCoreApplication>
+#include <QMessageBox>
+#include <QThread>
 using namespace configmaps;
 using namespace mars::utils;
 
 namespace xrock_gui_model
 {
 
-    FileDB::FileDB() : dbAddress("")
+    namespace
     {
+        // models without a domain were only shown in the SOFTWARE domain before
+        const char *defaultDomain = "SOFTWARE";
+
+        // Reads the top level domain of a model file without parsing the whole yaml
+        std::string scanDomain(const std::string &file)
+        {
+            std::ifstream in(file);
+            std::string line;
+            while (std::getline(in, line))
+            {
+                if (line.compare(0, 7, "domain:") != 0)
+                {
+                    continue;
+                }
+                size_t begin = line.find_first_not_of(" \t\"'", 7);
+                size_t end = line.find_last_not_of(" \t\r\"'");
+                if (begin == std::string::npos || end < begin)
+                {
+                    return "";
+                }
+                return line.substr(begin, end - begin + 1);
+            }
+            return "";
+        }
+
+        // journal records are tab separated, so tabs, newlines and backslashes in the fields are escaped
+        std::string escapeField(const std::string &field)
+        {
+            std::string result;
+            result.reserve(field.size());
+            for (char c : field)
+            {
+                switch (c)
+                {
+                case '\\':
+                    result += "\\\\";
+                    break;
+                case '\t':
+                    result += "\\t";
+                    break;
+                case '\n':
+                    result += "\\n";
+                    break;
+                default:
+                    result += c;
+                }
+            }
+            return result;
+        }
+
+        std::vector<std::string> splitRecord(const std::string &line)
+        {
+            std::vector<std::string> fields(1);
+            for (size_t i = 0; i < line.size(); ++i)
+            {
+                if (line[i] == '\t')
+                {
+                    fields.emplace_back();
+                }
+                else if (line[i] == '\\' && i + 1 < line.size())
+                {
+                    ++i;
+                    fields.back() += (line[i] == 't' ? '\t' : line[i] == 'n' ? '\n' : line[i]);
+                }
+                else
+                {
+                    fields.back() += line[i];
+                }
+            }
+            return fields;
+        }
+
+        // configmaps keep the insertion order of the keys, sorted keys make equal models serialize equally
+        void sortKeys(ConfigMap &map);
+
+        void sortKeys(ConfigItem &item)
+        {
+            if (item.isMap())
+            {
+                ConfigMap &map = item;
+                sortKeys(map);
+            }
+            else if (item.isVector())
+            {
+                for (auto &it : item)
+                {
+                    sortKeys(it);
+                }
+            }
+        }
+
+        void sortKeys(ConfigMap &map)
+        {
+            std::vector<std::string> keys;
+            for (auto &it : map)
+            {
+                keys.push_back(it.first);
+            }
+            std::sort(keys.begin(), keys.end());
+            ConfigMap sorted;
+            for (const auto &key : keys)
+            {
+                sorted[key] = map[key];
+                sortKeys(sorted[key]);
+            }
+            map = sorted;
+        }
+
+        // 64 bit FNV-1a, as hex string
+        std::string hashContent(const std::string &content)
+        {
+            unsigned long long hash = 14695981039346656037ULL;
+            for (unsigned char c : content)
+            {
+                hash ^= c;
+                hash *= 1099511628211ULL;
+            }
+            char buffer[17];
+            snprintf(buffer, sizeof(buffer), "%016llx", hash);
+            return buffer;
+        }
+
+        bool readFile(const std::string &file, std::string *content)
+        {
+            std::ifstream in(file, std::ios::binary);
+            if (!in)
+            {
+                return false;
+            }
+            std::stringstream stream;
+            stream << in.rdbuf();
+            *content = stream.str();
+            return true;
+        }
+
+        // the forms a version is stored in, in the order they are looked for
+        const char *versionFiles[] = {"model.json", "model.json.gz", "model.json.zst",
+                                      "model.yml", "model.yml.gz", "model.yml.zst", "model.ref", "model.delta"};
+
+        // model.yml or model.json, possibly compressed, as opposed to a reference or a delta
+        bool isCompleteVersionFile(const std::string &file)
+        {
+            const std::string name = fs::path(file).filename().string();
+            return name.compare(0, 9, "model.yml") == 0 || name.compare(0, 10, "model.json") == 0;
+        }
+
+        // Removes all forms of the version in folder except keep
+        void removeVersionFiles(const std::string &folder, const std::string &keep)
+        {
+            for (const char *name : versionFiles)
+            {
+                const std::string file = folder + "/" + name;
+                if (file != keep)
+                {
+                    std::remove(file.c_str());
+                }
+            }
+        }
+
+        // ConfigMap::fromYamlFile() which decompresses files and parses json files according to their extension
+        ConfigMap readConfigFile(const std::string &file)
+        {
+            const FileCompression::Format format = FileCompression::getFormat(file);
+            const std::string name = file.substr(0, file.size() - FileCompression::getExtension(format).size());
+            const bool json = name.size() >= 5 && name.compare(name.size() - 5, 5, ".json") == 0;
+            if (format == FileCompression::NONE)
+            {
+                return json ? ConfigMap::fromJsonFile(file) : ConfigMap::fromYamlFile(file);
+            }
+            std::string data, text, error;
+            if (!readFile(file, &data) || !FileCompression::decompress(format, data, &text, &error))
+            {
+                throw std::runtime_error("could not read " + file + (error.empty() ? std::string("") : ": " + error));
+            }
+            return json ? ConfigMap::fromJsonString(text) : ConfigMap::fromYamlString(text);
+        }
+
+        bool writeAll(int fd, const std::string &content)
+        {
+            size_t written = 0;
+            while (written < content.size())
+            {
+                ssize_t n = ::write(fd, content.data() + written, content.size() - written);
+                if (n < 0)
+                {
+                    return false;
+                }
+                written += n;
+            }
+            return true;
+        }
+    }
+
+    bool FileDB::FileStamp::operator==(const FileStamp &other) const
+    {
+        return (device == other.device &&
+                inode == other.inode &&
+                size == other.size &&
+                mtime.tv_sec == other.mtime.tv_sec &&
+                mtime.tv_nsec == other.mtime.tv_nsec);
+    }
+
+    bool FileDB::ModelEntry::hasVersion(const std::string &version) const
+    {
+        return std::binary_search(sortedVersions.begin(), sortedVersions.end(), version);
+    }
+
+    void FileDB::ModelEntry::addVersion(const std::string &version)
+    {
+        versions.push_back(version);
+        sortedVersions.insert(std::upper_bound(sortedVersions.begin(), sortedVersions.end(), version), version);
+    }
+
+    FileDB::FileDB(size_t numLoadThreads) : dbAddress(""), infoValid(false), indexCacheHits(0), indexCacheMisses(0),
+                                            journalExists(false), journalValidSize(0), journalRecords(0),
+                                            journalCompactionThreshold(256), resolvedDomainsLoaded(false), sharded(false), manifestStaleShards(0), deduplicate(false), deltaKeyframeInterval(0), compression(FileCompression::NONE), modelFormat(YAML), watchChanges(false), indexDirty(true), changeGeneration(0), nextListenerId(0),
+                                            dependenciesLoaded(false), dependentsValid(false), dependenciesUnsaved(false),
+                                            indexGeneration(0), dependenciesIndexGeneration(0), dependenciesChangeGeneration(0),
+                                            dependencyStampsChecked(false),
+                                            numLoadThreads(0)
+    {
+        setNumLoadThreads(numLoadThreads);
+    }
+
+    FileDB::~FileDB()
+    {
+        // stop notifications before the members they use are destroyed
+        watcher.reset();
+        if (reclaimThread.joinable())
+        {
+            reclaimThread.join();
+        }
+    }
+
+    bool FileDB::getFileStamp(const std::string &file, FileStamp *stamp)
+    {
+        struct stat st;
+        if (stat(file.c_str(), &st) != 0)
+        {
+            return false;
+        }
+        stamp->device = st.st_dev;
+        stamp->inode = st.st_ino;
+        stamp->size = st.st_size;
+#ifdef __APPLE__
+        stamp->mtime = st.st_mtimespec;
+#else
+        stamp->mtime = st.st_mtim;
+#endif
+        return true;
+    }
+
+    void FileDB::setNumLoadThreads(size_t numThreads)
+    {
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
+        if (numThreads == 0)
+        {
+            // reading is mostly I/O bound, more threads rarely pay off
+            numThreads = std::max(1u, std::min(8u, std::thread::hardware_concurrency()));
+        }
+        if (numThreads != numLoadThreads)
+        {
+            numLoadThreads = numThreads;
+            loadPool.reset();
+        }
+    }
+
+    ThreadPool &FileDB::getLoadPool()
+    {
+        if (!loadPool)
+        {
+            loadPool.reset(new ThreadPool(numLoadThreads));
+        }
+        return *loadPool;
+    }
+
+    void FileDB::warn(const std::string &message)
+    {
+        QCoreApplication *app = QCoreApplication::instance();
+        if (app && QThread::currentThread() == app->thread())
+        {
+            QMessageBox::warning(nullptr, "Warning", QString::fromStdString(message), QMessageBox::Ok);
+        }
+        else
+        {
+            std::cerr << "FileDB: " << message << std::endl;
+        }
+    }
+
+    std::string FileDB::getInfoFile() const
+    {
+        std::string file = "info.yml";
+        handleFilenamePrefix(&file, dbAddress);
+        if (pathExists(file))
+        {
+            return file;
+        }
+        for (FileCompression::Format format : {FileCompression::GZIP, FileCompression::ZSTD})
+        {
+            if (pathExists(file + FileCompression::getExtension(format)))
+            {
+                return file + FileCompression::getExtension(format);
+            }
+        }
+        return file;
+    }
+
+    FileDBSnapshot::Stamp FileDB::toSnapshotStamp(const FileStamp &stamp)
+    {
+        FileDBSnapshot::Stamp result;
+        result.device = stamp.device;
+        result.inode = stamp.inode;
+        result.size = stamp.size;
+        result.sec = stamp.mtime.tv_sec;
+        result.nsec = stamp.mtime.tv_nsec;
+        return result;
+    }
+
+    std::string FileDB::stampToString(const FileStamp &stamp)
+    {
+        return std::to_string(stamp.device) + ":" + std::to_string(stamp.inode) + ":" + std::to_string(stamp.size) + ":" +
+               std::to_string(stamp.mtime.tv_sec) + ":" + std::to_string(stamp.mtime.tv_nsec);
+    }
+
+    bool FileDB::stringToStamp(const std::string &text, FileStamp *stamp)
+    {
+        unsigned long long device, inode, sec, nsec;
+        long long size;
+        if (sscanf(text.c_str(), "%llu:%llu:%lld:%llu:%llu", &device, &inode, &size, &sec, &nsec) != 5)
+        {
+            return false;
+        }
+        stamp->device = device;
+        stamp->inode = inode;
+        stamp->size = size;
+        stamp->mtime.tv_sec = sec;
+        stamp->mtime.tv_nsec = nsec;
+        return true;
+    }
+
+    std::string FileDB::getSnapshotFile() const
+    {
+        std::string file = "snapshot.xpack";
+        handleFilenamePrefix(&file, dbAddress);
+        return file;
+    }
+
+    void FileDB::updateSnapshot()
+    {
+        FileStamp stamp;
+        if (!getFileStamp(getSnapshotFile(), &stamp))
+        {
+            snapshot.close();
+        }
+        else if (!snapshot.isOpen() || snapshot.getFileStamp() != toSnapshotStamp(stamp))
+        {
+            {
+                std::lock_guard<std::mutex> lock(watchMutex);
+                verifiedVersions.clear();
+            }
+            if (!snapshot.open(getSnapshotFile()))
+            {
+                std::cerr << "FileDB: ignoring invalid snapshot " << getSnapshotFile() << std::endl;
+            }
+        }
+    }
+
+    bool FileDB::loadInfoFromSnapshot(const FileStamp &stamp, bool currentJournalExists, const FileStamp &currentJournalStamp)
+    {
+        const FileDBSnapshot::IndexState &state = snapshot.getIndexState();
+        if (!snapshot.isOpen() || state.info != toSnapshotStamp(stamp) ||
+            state.journalExists != currentJournalExists ||
+            (currentJournalExists && state.journal != toSnapshotStamp(currentJournalStamp)))
+        {
+            return false;
+        }
+        if (!snapshot.decodeInfo(&info))
+        {
+            return false;
+        }
+        // the snapshot already contains the records of the journal
+        buildIndex();
+        journalExists = currentJournalExists;
+        journalStamp = currentJournalStamp;
+        journalValidSize = state.journalValidSize;
+        journalRecords = state.journalRecords;
+        return true;
+    }
+
+    std::string FileDB::getManifestFile() const
+    {
+        std::string file = "manifest.yml";
+        handleFilenamePrefix(&file, dbAddress);
+        return file;
+    }
+
+    std::string FileDB::getBlobDirectory() const
+    {
+        std::string folder = ".blobs";
+        handleFilenamePrefix(&folder, dbAddress);
+        return folder;
+    }
+
+    std::string FileDB::getBlobFile(const std::string &id) const
+    {
+        // fan out, so no directory gets too large
+        return getBlobDirectory() + "/" + id.substr(0, 2) + "/" + id + ".yml";
+    }
+
+    std::string FileDB::getShardFile(const std::string &model) const
+    {
+        std::string file = model + "/versions.yml";
+        handleFilenamePrefix(&file, dbAddress);
+        return file;
+    }
+
+    std::string FileDB::getDependencyFile() const
+    {
+        std::string file = ".dependencies";
+        handleFilenamePrefix(&file, dbAddress);
+        return file;
+    }
+
+    std::string FileDB::getDomainFile() const
+    {
+        std::string file = ".domains";
+        handleFilenamePrefix(&file, dbAddress);
+        return file;
+    }
+
+    std::string FileDB::getJournalFile() const
+    {
+        std::string file = "info.journal";
+        handleFilenamePrefix(&file, dbAddress);
+        return file;
+    }
+
+    bool FileDB::loadInfo()
+    {
+        if (isWatching() && infoValid && !indexDirty)
+        {
+            ++indexCacheHits;
+            return true;
+        }
+        // reset before checking, so changes during the check are not lost
+        indexDirty = false;
+        FileStamp stamp;
+        if (!getFileStamp(getInfoFile(), &stamp))
+        {
+            return loadShardedInfo();
+        }
+        if (sharded)
+        {
+            // the database was migrated to the single file layout
+            invalidateInfo();
+            sharded = false;
+        }
+        FileStamp currentJournalStamp;
+        bool currentJournalExists = getFileStamp(getJournalFile(), &currentJournalStamp);
+        if (infoValid && stamp == infoStamp && currentJournalExists == journalExists &&
+            (!journalExists || currentJournalStamp == journalStamp))
+        {
+            ++indexCacheHits;
+            return true;
+        }
+        ++indexCacheMisses;
+        infoStamp = stamp;
+        infoValid = true;
+        try
+        {
+            updateSnapshot();
+            if (!loadInfoFromSnapshot(stamp, currentJournalExists, currentJournalStamp))
+            {
+                info = readConfigFile(getInfoFile());
+                buildIndex();
+                replayJournal();
+            }
+            resolveDomains();
+            buildDomainIndex();
+        }
+        catch (...)
+        {
+            // a broken or half-written info.yml must not count as loaded, the next call parses it again
+            invalidateInfo();
+            indexDirty = true;
+            throw;
+        }
+        return true;
+    }
+
+    void FileDB::invalidateInfo()
+    {
+        info = ConfigMap();
+        infoValid = false;
+        modelIndex.clear();
+        modelOrder.clear();
+        domainModels.clear();
+        tombstones.clear();
+        journalExists = false;
+        journalStamp = FileStamp();
+        journalValidSize = 0;
+        journalRecords = 0;
+        shardStamps.clear();
+        manifestStamp = FileStamp();
+        shardDirStamp = FileStamp();
+        manifestStaleShards = 0;
+    }
+
+    bool FileDB::loadShardedInfo()
+    {
+        FileStamp currentManifestStamp;
+        if (!getFileStamp(getManifestFile(), &currentManifestStamp))
+        {
+            invalidateInfo();
+            return false;
+        }
+        if (!sharded)
+        {
+            invalidateInfo();
+            sharded = true;
+        }
+        // taken before the check, so changes meanwhile are found by the next load
+        FileStamp currentDirStamp;
+        getFileStamp(dbAddress.empty() ? std::string(".") : dbAddress, &currentDirStamp);
+        if (infoValid && currentManifestStamp == manifestStamp && currentDirStamp == shardDirStamp)
+        {
+            ++indexCacheHits;
+            return true;
+        }
+        updateSnapshot();
+        if (!infoValid)
+        {
+            // the manifest holds the index as of its last rewrite, only the shards changed since are read
+            ConfigMap manifest;
+            try
+            {
+                manifest = ConfigMap::fromYamlFile(getManifestFile());
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "FileDB: ignoring invalid manifest " << getManifestFile() << ": " << e.what() << std::endl;
+            }
+            if (manifest.hasKey("models"))
+            {
+                info["models"] = manifest["models"];
+            }
+            if (manifest.hasKey("shards"))
+            {
+                ConfigMap &shards = manifest["shards"];
+                for (auto &it : shards)
+                {
+                    FileStamp stamp;
+                    if (stringToStamp(it.second.getString(), &stamp))
+                    {
+                        shardStamps[it.first] = stamp;
+                    }
+                }
+            }
+        }
+
+        // every model directory with a versions.yml is a shard
+        std::map<std::string, FileStamp> current;
+        std::error_code ec;
+        for (fs::directory_iterator it(dbAddress.empty() ? std::string(".") : dbAddress, ec), end; !ec && it != end; it.increment(ec))
+        {
+            const std::string name = it->path().filename().string();
+            FileStamp stamp;
+            if (!name.empty() && name[0] != '.' && getFileStamp(getShardFile(name), &stamp))
+            {
+                current[name] = stamp;
+            }
+        }
+        std::vector<std::string> changed;
+        for (const auto &it : current)
+        {
+            auto known = shardStamps.find(it.first);
+            if (known == shardStamps.end() || known->second != it.second)
+            {
+                changed.push_back(it.first);
+            }
+        }
+        size_t removed = 0;
+        for (const auto &name : modelOrder)
+        {
+            removed += current.count(name) == 0;
+        }
+        if (infoValid && changed.empty() && removed == 0)
+        {
+            manifestStamp = currentManifestStamp;
+            shardDirStamp = currentDirStamp;
+            ++indexCacheHits;
+            return true;
+        }
+        ++indexCacheMisses;
+
+        std::vector<ConfigMap> shards(changed.size());
+        std::vector<std::string> errors(changed.size());
+        getLoadPool().parallelFor(changed.size(), [&](size_t i)
+                                  {
+            try
+            {
+                shards[i] = ConfigMap::fromYamlFile(getShardFile(changed[i]));
+            }
+            catch (const std::exception &e)
+            {
+                errors[i] = "could not read " + getShardFile(changed[i]) + ": " + e.what();
+            } });
+        std::map<std::string, ConfigMap> parsed;
+        for (size_t i = 0; i < changed.size(); ++i)
+        {
+            if (!errors[i].empty())
+            {
+                // no stamp is recorded, so the shard is read again by the next load
+                std::cerr << "FileDB: " << errors[i] << std::endl;
+                continue;
+            }
+            shards[i]["name"] = changed[i];
+            parsed[changed[i]] = shards[i];
+            shardStamps[changed[i]] = current[changed[i]];
+        }
+
+        // keep the order of the known models, new ones are appended sorted by name
+        ConfigVector models;
+        if (info.hasKey("models"))
+        {
+            for (auto &it : info["models"])
+            {
+                const std::string name = it["name"];
+                if (current.count(name) == 0)
+                {
+                    shardStamps.erase(name);
+                    continue;
+                }
+                auto shard = parsed.find(name);
+                if (shard == parsed.end())
+                {
+                    models.push_back(it);
+                }
+                else
+                {
+                    models.push_back(ConfigItem(shard->second));
+                    parsed.erase(shard);
+                }
+            }
+        }
+        for (auto &it : parsed)
+        {
+            models.push_back(ConfigItem(it.second));
+        }
+        info = ConfigMap();
+        info["models"] = models;
+        buildIndex();
+        resolveDomains();
+        buildDomainIndex();
+        infoValid = true;
+        manifestStamp = currentManifestStamp;
+        shardDirStamp = currentDirStamp;
+
+        manifestStaleShards += changed.size() + removed;
+        if (manifestStaleShards >= manifestRewriteThreshold)
+        {
+            // the database may be read-only, then the changed shards are read on every start
+            writeManifest();
+        }
+        return true;
+    }
+
+    bool FileDB::writeManifest()
+    {
+        ConfigMap manifest;
+        manifest["models"] = info.hasKey("models") ? info["models"] : ConfigItem(ConfigVector());
+        for (const auto &it : shardStamps)
+        {
+            manifest["shards"][it.first] = stampToString(it.second);
+        }
+        if (!writeFileAtomic(getManifestFile(), manifest.toYamlString()))
+        {
+            return false;
+        }
+        manifestStaleShards = 0;
+        return true;
+    }
+
+    bool FileDB::updateShard(const std::string &model, const std::function<void(ConfigMap &)> &change)
+    {
+        const std::string file = getShardFile(model);
+        ConfigMap shard;
+        // start from the file, other processes may have added versions since the index was loaded
+        if (pathExists(file))
+        {
+            shard = ConfigMap::fromYamlFile(file);
+        }
+        shard["name"] = model;
+        change(shard);
+        // the next load reads the shard again
+        shardStamps.erase(model);
+        ++manifestStaleShards;
+        bool written;
+        if (!shard.hasKey("versions") || shard["versions"].size() == 0)
+        {
+            written = std::remove(file.c_str()) == 0 || !pathExists(file);
+        }
+        else
+        {
+            written = writeFileAtomic(file, shard.toYamlString());
+        }
+        // the new mtime of the manifest tells all processes to check the shards again
+        if (utimensat(AT_FDCWD, getManifestFile().c_str(), nullptr, 0) != 0)
+        {
+            std::cerr << "FileDB: could not touch " << getManifestFile() << std::endl;
+        }
+        return written;
+    }
+
+    void FileDB::replayJournal()
+    {
+        journalExists = false;
+        journalStamp = FileStamp();
+        journalValidSize = 0;
+        journalRecords = 0;
+        tombstones.clear();
+        int fd = ::open(getJournalFile().c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return;
+        }
+        std::string content;
+        char buffer[65536];
+        ssize_t n;
+        while ((n = ::read(fd, buffer, sizeof(buffer))) > 0)
+        {
+            content.append(buffer, n);
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0)
+        {
+            journalExists = true;
+            journalStamp.device = st.st_dev;
+            journalStamp.inode = st.st_ino;
+            journalStamp.size = st.st_size;
+#ifdef __APPLE__
+            journalStamp.mtime = st.st_mtimespec;
+#else
+            journalStamp.mtime = st.st_mtim;
+#endif
+        }
+        ::close(fd);
+
+        size_t start = 0, end;
+        // a last line without newline is a record torn by a crash and is ignored
+        while ((end = content.find('\n', start)) != std::string::npos)
+        {
+            std::vector<std::string> fields = splitRecord(content.substr(start, end - start));
+            if (fields[0] == "add" && fields.size() >= 4)
+            {
+                // records of older versions have no domain
+                applyAdd(fields[1], fields[2], fields[3], fields.size() >= 5 ? fields[4] : std::string(""));
+            }
+            else if (fields[0] == "remove" && fields.size() >= 3)
+            {
+                applyRemove(fields[1], fields[2]);
+            }
+            ++journalRecords;
+            start = end + 1;
+        }
+        journalValidSize = start;
+        // finish removals which were interrupted before their directories were moved
+        moveTombstonesToTrash();
+    }
+
+    bool FileDB::appendJournal(const std::vector<std::string> &fields)
+    {
+        std::string line;
+        for (const auto &field : fields)
+        {
+            if (!line.empty())
+            {
+                line += '\t';
+            }
+            line += escapeField(field);
+        }
+        line += '\n';
+
+        const std::string file = getJournalFile();
+        int fd = ::open(file.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd < 0)
+        {
+            return false;
+        }
+        // drop a torn record, otherwise it would be glued to the new one
+        if (journalExists && journalStamp.size != journalValidSize)
+        {
+            if (ftruncate(fd, journalValidSize) != 0)
+            {
+                ::close(fd);
+                return false;
+            }
+        }
+        bool ok = writeAll(fd, line) && fsync(fd) == 0;
+        ::close(fd);
+        if (!ok)
+        {
+            return false;
+        }
+        journalValidSize += line.size();
+        ++journalRecords;
+        // our own append must not count as external change
+        journalExists = getFileStamp(file, &journalStamp);
+        return true;
+    }
+
+    void FileDB::applyAdd(const std::string &model, const std::string &type, const std::string &version, const std::string &domain)
+    {
+        ++indexGeneration;
+        auto entry = modelIndex.find(model);
+        if (entry == modelIndex.end())
+        {
+            ConfigMap modelMap;
+            modelMap["name"] = model;
+            modelMap["type"] = type;
+            entry = modelIndex.emplace(model, ModelEntry()).first;
+            entry->second.type = type;
+            entry->second.infoPosition = info["models"].size();
+            modelOrder.push_back(model);
+            info["models"].push_back(modelMap);
+        }
+        ModelEntry &modelEntry = entry->second;
+        if (!domain.empty() && domain != modelEntry.domain)
+        {
+            // a model is listed in one domain, the last stored version decides
+            if (!modelEntry.domain.empty())
+            {
+                std::vector<std::string> &models = domainModels[modelEntry.domain];
+                models.erase(std::remove(models.begin(), models.end(), model), models.end());
+                if (models.empty())
+                {
+                    domainModels.erase(modelEntry.domain);
+                }
+            }
+            modelEntry.domain = domain;
+            info["models"][modelEntry.infoPosition]["domain"] = domain;
+            std::vector<std::string> &models = domainModels[domain];
+            // keep the order of info.yml
+            auto position = std::find_if(models.begin(), models.end(), [&](const std::string &name)
+                                         { return modelIndex[name].infoPosition > modelEntry.infoPosition; });
+            models.insert(position, model);
+        }
+        if (!entry->second.hasVersion(version))
+        {
+            ConfigMap versionMap;
+            versionMap["name"] = version;
+            info["models"][entry->second.infoPosition]["versions"].push_back(versionMap);
+            entry->second.addVersion(version);
+        }
+    }
+
+    void FileDB::applyRemove(const std::string &model, const std::string &version)
+    {
+        ++indexGeneration;
+        auto entry = modelIndex.find(model);
+        if (entry == modelIndex.end())
+        {
+            return;
+        }
+        ModelEntry &modelEntry = entry->second;
+        std::vector<std::string> removed;
+        if (version.empty())
+        {
+            removed = modelEntry.versions;
+            modelEntry.versions.clear();
+            modelEntry.sortedVersions.clear();
+        }
+        else if (modelEntry.hasVersion(version))
+        {
+            removed.push_back(version);
+            modelEntry.versions.erase(std::find(modelEntry.versions.begin(), modelEntry.versions.end(), version));
+            modelEntry.sortedVersions.erase(std::lower_bound(modelEntry.sortedVersions.begin(), modelEntry.sortedVersions.end(), version));
+        }
+        for (const auto &it : removed)
+        {
+            tombstones.insert(std::make_pair(model, it));
+        }
+        ConfigVector &versions = info["models"][modelEntry.infoPosition]["versions"];
+        for (auto it = versions.begin(); it != versions.end();)
+        {
+            if (std::find(removed.begin(), removed.end(), (*it)["name"].getString()) != removed.end())
+            {
+                it = versions.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        if (!modelEntry.versions.empty())
+        {
+            return;
+        }
+        // the last version is gone, so is the model
+        const size_t position = modelEntry.infoPosition;
+        ConfigVector &models = info["models"];
+        models.erase(models.begin() + position);
+        auto domain = domainModels.find(modelEntry.domain);
+        if (domain != domainModels.end())
+        {
+            domain->second.erase(std::remove(domain->second.begin(), domain->second.end(), model), domain->second.end());
+            if (domain->second.empty())
+            {
+                domainModels.erase(domain);
+            }
+        }
+        modelIndex.erase(entry);
+        modelOrder.erase(std::find(modelOrder.begin(), modelOrder.end(), model));
+        for (auto &it : modelIndex)
+        {
+            if (it.second.infoPosition > position)
+            {
+                --it.second.infoPosition;
+            }
+        }
+    }
+
+    std::string FileDB::getTrashDirectory() const
+    {
+        std::string folder = ".trash";
+        handleFilenamePrefix(&folder, dbAddress);
+        return folder;
+    }
+
+    bool FileDB::moveToTrash(const std::string &path)
+    {
+        static size_t counter = 0;
+        const std::string trash = getTrashDirectory();
+        createDirectory(trash);
+        std::string name = fs::path(path).filename().string() + "." +
+                           std::to_string(std::time(nullptr)) + "." + std::to_string(getpid()) + "." +
+                           std::to_string(counter++);
+        return std::rename(path.c_str(), (trash + "/" + name).c_str()) == 0;
+    }
+
+    void FileDB::moveTombstonesToTrash()
+    {
+        bool moved = false;
+        for (const auto &it : tombstones)
+        {
+            // the version could have been stored again after it was removed
+            const ModelEntry *entry = findModel(it.first);
+            if (entry && entry->hasVersion(it.second))
+            {
+                continue;
+            }
+            std::string folder = it.first + "/" + it.second;
+            handleFilenamePrefix(&folder, dbAddress);
+            if (pathExists(folder))
+            {
+                moved |= moveToTrash(folder);
+            }
+            if (!entry)
+            {
+                std::string modelFolder = it.first;
+                handleFilenamePrefix(&modelFolder, dbAddress);
+                if (pathExists(modelFolder))
+                {
+                    moved |= moveToTrash(modelFolder);
+                }
+            }
+        }
+        std::error_code ec;
+        if (moved || (pathExists(getTrashDirectory()) && !fs::is_empty(getTrashDirectory(), ec)))
+        {
+            reclaimTrash();
+        }
+    }
+
+    void FileDB::reclaimTrash()
+    {
+        if (reclaimThread.joinable())
+        {
+            reclaimThread.join();
+        }
+        const std::string trash = getTrashDirectory();
+        reclaimThread = std::thread([trash]
+                                    {
+            std::error_code ec;
+            for (const auto &entry : fs::directory_iterator(trash, ec))
+            {
+                fs::remove_all(entry.path(), ec);
+                if (ec)
+                {
+                    std::cerr << "FileDB: could not remove " << entry.path() << ": " << ec.message() << std::endl;
+                }
+            } });
+    }
+
+    void FileDB::setWatchChanges(bool watch)
+    {
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
+        watchChanges = watch;
+        watcher.reset();
+        indexDirty = true;
+        if (watchChanges && !dbAddress.empty())
+        {
+            watcher.reset(new FileDBWatcher(dbAddress, [this](bool indexChanged, const std::set<std::string> &models)
+                                            { handleChanges(indexChanged, models); }));
+            if (!watcher->isActive())
+            {
+                watcher.reset();
+            }
+        }
+        std::lock_guard<std::mutex> watchLock(watchMutex);
+        verifiedVersions.clear();
+        verifiedDependencies.clear();
+    }
+
+    void FileDB::handleChanges(bool indexChanged, const std::set<std::string> &models)
+    {
+        if (indexChanged)
+        {
+            indexDirty = true;
+        }
+        {
+            std::lock_guard<std::mutex> lock(watchMutex);
+            ++changeGeneration;
+            if (models.count(""))
+            {
+                verifiedVersions.clear();
+                verifiedDependencies.clear();
+                // also sent when the watcher fails, the files may have changed unnoticed
+                dependencyStampsChecked = false;
+            }
+            else
+            {
+                // only the versions of the changed models have to be checked again
+                for (const auto &model : models)
+                {
+                    const std::string prefix = model + "/";
+                    auto it = verifiedVersions.lower_bound(prefix);
+                    while (it != verifiedVersions.end() && it->compare(0, prefix.size(), prefix) == 0)
+                    {
+                        it = verifiedVersions.erase(it);
+                    }
+                    it = verifiedDependencies.lower_bound(prefix);
+                    while (it != verifiedDependencies.end() && it->compare(0, prefix.size(), prefix) == 0)
+                    {
+                        it = verifiedDependencies.erase(it);
+                    }
+                }
+            }
+        }
+        std::lock_guard<std::mutex> lock(listenerMutex);
+        for (const auto &listener : listeners)
+        {
+            if (models.empty())
+            {
+                listener.second("", "");
+            }
+            for (const auto &model : models)
+            {
+                listener.second("", model);
+            }
+        }
+    }
+
+    int FileDB::addChangeListener(ChangeListener listener)
+    {
+        std::lock_guard<std::mutex> lock(listenerMutex);
+        listeners[nextListenerId] = listener;
+        return nextListenerId++;
+    }
+
+    void FileDB::removeChangeListener(int id)
+    {
+        std::lock_guard<std::mutex> lock(listenerMutex);
+        listeners.erase(id);
+    }
+
+    std::string FileDB::getUri(const std::string &domain, const std::string &model, const std::string &version)
+    {
+        return "filedb://" + domain + "/" + model + (version.empty() ? "" : "/" + version);
+    }
+
+    bool FileDB::parseUri(const std::string &uri, std::string *domain, std::string *model, std::string *version)
+    {
+        const std::string scheme = "filedb://";
+        if (uri.compare(0, scheme.size(), scheme) != 0)
+        {
+            return false;
+        }
+        std::vector<std::string> parts;
+        size_t start = scheme.size(), end;
+        while ((end = uri.find('/', start)) != std::string::npos)
+        {
+            parts.push_back(uri.substr(start, end - start));
+            start = end + 1;
+        }
+        parts.push_back(uri.substr(start));
+        if (parts.size() < 2 || parts.size() > 3 || parts[1].empty())
+        {
+            return false;
+        }
+        *domain = parts[0];
+        *model = parts[1];
+        *version = parts.size() == 3 ? parts[2] : "";
+        return true;
+    }
+
+    bool FileDB::removeModel(const std::string &uri)
+    {
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
+        std::string domain, model, version;
+        if (!parseUri(uri, &domain, &model, &version))
+        {
+            warn("invalid uri: " + uri);
+            return false;
+        }
+        if (!loadInfo())
+        {
+            warn(getInfoFile() + " doesn't exist");
+            return false;
+        }
+        const ModelEntry *entry = findModel(model);
+        if (!entry || (!version.empty() && !entry->hasVersion(version)))
+        {
+            return false;
+        }
+        if (!version.empty() && !materializeDependent(model, version))
+        {
+            return false;
+        }
+        if (sharded)
+        {
+            // the shard is the removal, moving the files only finishes it
+            bool written = updateShard(model, [&](ConfigMap &shard)
+                                       {
+                if (version.empty() || !shard.hasKey("versions"))
+                {
+                    shard.erase("versions");
+                    return;
+                }
+                ConfigVector &versions = shard["versions"];
+                for (auto it = versions.begin(); it != versions.end();)
+                {
+                    if ((*it)["name"].getString() == version)
+                    {
+                        it = versions.erase(it);
+                    }
+                    else
+                    {
+                        ++it;
+                    }
+                } });
+            if (!written)
+            {
+                warn("could not write " + getShardFile(model));
+                return false;
+            }
+            applyRemove(model, version);
+            moveTombstonesToTrash();
+            // without a journal the tombstones are not needed after the move
+            tombstones.clear();
+            return true;
+        }
+        // the tombstone is the removal, moving the files only finishes it
+        if (!appendJournal({"remove", model, version}))
+        {
+            warn("could not write " + getJournalFile());
+            return false;
+        }
+        applyRemove(model, version);
+        moveTombstonesToTrash();
+        if (journalRecords >= journalCompactionThreshold && !compact())
+        {
+            warn("could not compact " + getInfoFile());
+        }
+        return true;
+    }
+
+    bool FileDB::writeBlob(const ConfigMap &map, std::string *id)
+    {
+        ConfigMap body = map;
+        body.erase("name");
+        if (body.hasKey("versions") && body["versions"].size() > 0)
+        {
+            ConfigMap &version = body["versions"][0];
+            version.erase("name");
+            version.erase("date");
+        }
+        sortKeys(body);
+        const std::string content = body.toYamlString();
+        const std::string hash = hashContent(content);
+        for (size_t i = 0;; ++i)
+        {
+            // different bodies with the same hash get numbered ids
+            *id = i == 0 ? hash : hash + "-" + std::to_string(i);
+            const std::string file = getBlobFile(*id);
+            std::string existing;
+            if (!readFile(file, &existing))
+            {
+                createDirectory(fs::path(file).parent_path().string());
+                return writeFileAtomic(file, content);
+            }
+            if (existing == content)
+            {
+                return true;
+            }
+        }
+    }
+
+    bool FileDB::writeVersionFiles(const std::string &folder, const ConfigMap &map_, bool asBlob)
+    {
+        ConfigMap map = map_;
+        const std::string refFile = folder + "/model.ref";
+        if (!asBlob)
+        {
+            const std::string modelFile = folder + "/" + getVersionFileName();
+            std::string data;
+            const std::string content = modelFormat == JSON ? map.toJsonString() : map.toYamlString();
+            if (!FileCompression::compress(compression, content, &data) || !writeFileAtomic(modelFile, data))
+            {
+                return false;
+            }
+            removeVersionFiles(folder, modelFile);
+            return true;
+        }
+        std::string id;
+        if (!writeBlob(map, &id))
+        {
+            return false;
+        }
+        ConfigMap ref;
+        ref["blob"] = id;
+        ref["name"] = map["name"].getString();
+        if (map.hasKey("versions") && map["versions"].size() > 0)
+        {
+            ref["version"] = map["versions"][0]["name"].getString();
+            if (map["versions"][0].hasKey("date"))
+            {
+                ref["date"] = map["versions"][0]["date"].getString();
+            }
+        }
+        if (!writeFileAtomic(refFile, ref.toYamlString()))
+        {
+            return false;
+        }
+        // model.yml is read in favour of the reference
+        removeVersionFiles(folder, refFile);
+        return true;
+    }
+
+    bool FileDB::readRef(const std::string &file, ConfigMap *map, std::string *error) const
+    {
+        ConfigMap ref;
+        try
+        {
+            ref = ConfigMap::fromYamlFile(file);
+        }
+        catch (const std::exception &e)
+        {
+            *error = "could not read " + file + ": " + e.what();
+            return false;
+        }
+        if (!ref.hasKey("blob"))
+        {
+            *error = file + " references no blob";
+            return false;
+        }
+        const std::string blob = getBlobFile(ref["blob"].getString());
+        if (!pathExists(blob))
+        {
+            *error = blob + " doesn't exist";
+            return false;
+        }
+        try
+        {
+            *map = ConfigMap::fromYamlFile(blob);
+        }
+        catch (const std::exception &e)
+        {
+            *error = "could not read " + blob + ": " + e.what();
+            return false;
+        }
+        (*map)["name"] = ref["name"].getString();
+        if (ref.hasKey("version"))
+        {
+            (*map)["versions"][0]["name"] = ref["version"].getString();
+        }
+        if (ref.hasKey("date"))
+        {
+            (*map)["versions"][0]["date"] = ref["date"].getString();
+        }
+        return true;
+    }
+
+    bool FileDB::readDelta(const std::string &model, const std::string &file, ConfigMap *map, std::string *error,
+                           size_t depth) const
+    {
+        ConfigMap delta;
+        try
+        {
+            delta = ConfigMap::fromYamlFile(file);
+        }
+        catch (const std::exception &e)
+        {
+            // e.g. truncated by a crash
+            *error = "could not read " + file + ": " + e.what();
+            return false;
+        }
+        const std::string base = delta.hasKey("base") ? delta["base"].getString() : std::string("");
+        if (base.empty() || base == fs::path(file).parent_path().filename().string())
+        {
+            *error = file + " has no valid base version";
+            return false;
+        }
+        // the runs grow by one along a chain and a keyframe follows before the interval is reached,
+        // so a longer chain is broken, e.g. a cycle of bases
+        const size_t run = delta.hasKey("run") ? (size_t)(int)delta["run"] : 0;
+        if (depth >= run)
+        {
+            *error = file + " is part of a chain of deltas longer than its keyframe interval";
+            return false;
+        }
+        if (!readCachedVersion(model, base, map, error, depth + 1))
+        {
+            return false;
+        }
+        if (!ModelDelta::apply(*map, delta["diff"]))
+        {
+            *error = file + " does not match its base version " + base;
+            return false;
+        }
+        return true;
+    }
+
+    bool FileDB::readCachedVersion(const std::string &model, const std::string &version, ConfigMap *map, std::string *error,
+                                   size_t depth) const
+    {
+        const std::string key = model + "/" + version;
+        std::string file;
+        FileStamp stamp;
+        if (getVersionFile(model, version, &file, &stamp))
+        {
+            std::lock_guard<std::mutex> lock(deltaCacheMutex);
+            for (auto it = deltaCache.begin(); it != deltaCache.end(); ++it)
+            {
+                if (it->key == key && it->stamp == stamp)
+                {
+                    deltaCache.splice(deltaCache.begin(), deltaCache, it);
+                    *map = it->map;
+                    return true;
+                }
+            }
+        }
+        if (!readRawVersion(model, version, map, &stamp, error, depth))
+        {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(deltaCacheMutex);
+        deltaCache.remove_if([&key](const CachedVersion &cached)
+                             { return cached.key == key; });
+        deltaCache.push_front(CachedVersion{key, stamp, *map});
+        if (deltaCache.size() > deltaCacheCapacity)
+        {
+            deltaCache.pop_back();
+        }
+        return true;
+    }
+
+    bool FileDB::storeAsDelta(const std::string &model, const std::string &version, const std::string &base)
+    {
+        const ModelEntry *entry = findModel(model);
+        if (!entry)
+        {
+            return false;
+        }
+        std::string folder = model + "/" + version;
+        handleFilenamePrefix(&folder, dbAddress);
+        if (pathExists(folder + "/model.delta"))
+        {
+            return true;
+        }
+        // the run of deltas continues the one of the predecessor, which is a delta against this version
+        size_t run = 1;
+        auto it = std::find(entry->versions.begin(), entry->versions.end(), version);
+        if (it != entry->versions.begin() && it != entry->versions.end())
+        {
+            std::string previous = model + "/" + *(it - 1) + "/model.delta";
+            handleFilenamePrefix(&previous, dbAddress);
+            if (pathExists(previous))
+            {
+                ConfigMap previousDelta = ConfigMap::fromYamlFile(previous);
+                run = (int)previousDelta["run"] + 1;
+            }
+        }
+        if (run >= deltaKeyframeInterval)
+        {
+            // keyframe, bounds the length of the chain to reconstruct
+            return true;
+        }
+        ConfigMap from, to;
+        FileStamp stamp;
+        std::string error;
+        if (!readRawVersion(model, base, &from, &stamp, &error) || !readRawVersion(model, version, &to, &stamp, &error))
+        {
+            std::cerr << "FileDB: " << error << std::endl;
+            return false;
+        }
+        ConfigMap delta;
+        delta["base"] = base;
+        delta["run"] = (int)run;
+        delta["diff"] = ModelDelta::diff(from, to);
+        if (!writeFileAtomic(folder + "/model.delta", delta.toYamlString()))
+        {
+            return false;
+        }
+        // model.yml and model.ref are read in favour of the delta
+        removeVersionFiles(folder, folder + "/model.delta");
+        return true;
+    }
+
+    bool FileDB::materializeDependent(const std::string &model, const std::string &version)
+    {
+        const ModelEntry *entry = findModel(model);
+        if (!entry)
+        {
+            return true;
+        }
+        auto it = std::find(entry->versions.begin(), entry->versions.end(), version);
+        if (it == entry->versions.begin() || it == entry->versions.end())
+        {
+            return true;
+        }
+        const std::string previous = *(it - 1);
+        std::string folder = model + "/" + previous;
+        handleFilenamePrefix(&folder, dbAddress);
+        if (!pathExists(folder + "/model.delta"))
+        {
+            return true;
+        }
+        ConfigMap map;
+        FileStamp stamp;
+        std::string error;
+        if (!readRawVersion(model, previous, &map, &stamp, &error))
+        {
+            warn(error);
+            return false;
+        }
+        return writeVersionFiles(folder, map, deduplicate);
+    }
+
+    bool FileDB::deduplicateVersions(size_t *numVersions, size_t *numBlobs)
+    {
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
+        if (!loadInfo())
+        {
+            warn(getInfoFile() + " doesn't exist");
+            return false;
+        }
+        std::set<std::string> used;
+        size_t converted = 0;
+        for (const auto &name : modelOrder)
+        {
+            for (const auto &version : modelIndex[name].versions)
+            {
+                std::string folder = name + "/" + version;
+                handleFilenamePrefix(&folder, dbAddress);
+                std::string file;
+                FileStamp stamp;
+                if (getVersionFile(name, version, &file, &stamp) && isCompleteVersionFile(file))
+                {
+                    ConfigMap map;
+                    std::string error;
+                    if (!readRawVersion(name, version, &map, &stamp, &error))
+                    {
+                        warn(error);
+                        return false;
+                    }
+                    if (!writeVersionFiles(folder, map, true))
+                    {
+                        warn("could not write " + folder);
+                        return false;
+                    }
+                    ++converted;
+                }
+                if (pathExists(folder + "/model.ref"))
+                {
+                    ConfigMap ref = ConfigMap::fromYamlFile(folder + "/model.ref");
+                    used.insert(ref["blob"].getString());
+                }
+            }
+        }
+        // blobs of removed or overwritten versions
+        std::vector<std::string> unused;
+        std::error_code ec;
+        for (fs::recursive_directory_iterator it(getBlobDirectory(), ec), end; !ec && it != end; it.increment(ec))
+        {
+            if (it->path().extension() == ".yml" && used.count(it->path().stem().string()) == 0)
+            {
+                unused.push_back(it->path().string());
+            }
+        }
+        for (const auto &file : unused)
+        {
+            std::remove(file.c_str());
+        }
+        if (numVersions)
+        {
+            *numVersions = converted;
+        }
+        if (numBlobs)
+        {
+            *numBlobs = used.size();
+        }
+        return true;
+    }
+
+    std::string FileDB::getVersionFileName() const
+    {
+        return (modelFormat == JSON ? "model.json" : "model.yml") + FileCompression::getExtension(compression);
+    }
+
+    bool FileDB::detectFileFormat(ModelFormat *format, FileCompression::Format *compression)
+    {
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
+        if (!loadInfo())
+        {
+            warn(getInfoFile() + " doesn't exist");
+            return false;
+        }
+        *format = YAML;
+        *compression = sharded ? FileCompression::NONE : FileCompression::getFormat(getInfoFile());
+        for (const auto &name : modelOrder)
+        {
+            for (const auto &version : modelIndex[name].versions)
+            {
+                std::string file;
+                FileStamp stamp;
+                // references and deltas tell nothing about the model files
+                if (getVersionFile(name, version, &file, &stamp) && isCompleteVersionFile(file))
+                {
+                    *format = fs::path(file).filename().string().compare(0, 10, "model.json") == 0 ? JSON : YAML;
+                    *compression = FileCompression::getFormat(file);
+                    return true;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool FileDB::rewriteModelFiles(size_t *numVersions)
+    {
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
+        if (!loadInfo())
+        {
+            warn(getInfoFile() + " doesn't exist");
+            return false;
+        }
+        size_t rewritten = 0;
+        for (const auto &name : modelOrder)
+        {
+            for (const auto &version : modelIndex[name].versions)
+            {
+                std::string folder = name + "/" + version;
+                handleFilenamePrefix(&folder, dbAddress);
+                std::string file;
+                FileStamp stamp;
+                // references and deltas keep their form
+                if (!getVersionFile(name, version, &file, &stamp) || !isCompleteVersionFile(file) ||
+                    file == folder + "/" + getVersionFileName())
+                {
+                    continue;
+                }
+                ConfigMap map;
+                std::string error;
+                if (!readRawVersion(name, version, &map, &stamp, &error))
+                {
+                    warn(error);
+                    return false;
+                }
+                if (!writeVersionFiles(folder, map, false))
+                {
+                    warn("could not write " + folder);
+                    return false;
+                }
+                ++rewritten;
+            }
+        }
+        std::string infoFile = "info.yml" + FileCompression::getExtension(compression);
+        handleFilenamePrefix(&infoFile, dbAddress);
+        if (!sharded && getInfoFile() != infoFile && !writeInfo())
+        {
+            warn("could not write " + infoFile);
+            return false;
+        }
+        if (numVersions)
+        {
+            *numVersions = rewritten;
+        }
+        return true;
+    }
+
+    bool FileDB::writeFileAtomic(const std::string &file, const std::string &content)
+    {
+        const std::string tmpFile = file + ".tmp" + std::to_string(getpid());
+        int fd = ::open(tmpFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+        {
+            return false;
+        }
+        bool ok = writeAll(fd, content) && fsync(fd) == 0;
+        ok = (::close(fd) == 0) && ok;
+        if (!ok || std::rename(tmpFile.c_str(), file.c_str()) != 0)
+        {
+            std::remove(tmpFile.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    bool FileDB::compact()
+    {
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
+        if (!loadInfo())
+        {
+            return false;
+        }
+        if (sharded)
+        {
+            return writeManifest();
+        }
+        if (!journalExists)
+        {
+            return true;
+        }
+        // info.yml is replaced first: if we crash before the journal is removed,
+        // replaying it again is harmless because adding a known version is a no-op
+        if (!writeInfo())
+        {
+            return false;
+        }
+        std::remove(getJournalFile().c_str());
+        tombstones.clear();
+        journalExists = false;
+        journalStamp = FileStamp();
+        journalValidSize = 0;
+        journalRecords = 0;
+        return true;
+    }
+
+    bool FileDB::migrateLayout(bool toSharded)
+    {
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
+        if (!loadInfo())
+        {
+            warn(getInfoFile() + " doesn't exist");
+            return false;
+        }
+        if (toSharded == sharded)
+        {
+            return true;
+        }
+        if (toSharded)
+        {
+            for (auto &it : info["models"])
+            {
+                ConfigMap shard = it;
+                if (!shard.hasKey("versions") || shard["versions"].size() == 0)
+                {
+                    continue;
+                }
+                const std::string file = getShardFile(shard["name"].getString());
+                createDirectory(fs::path(file).parent_path().string());
+                if (!writeFileAtomic(file, shard.toYamlString()))
+                {
+                    warn("could not write " + file);
+                    return false;
+                }
+            }
+            // without stamps, the first load reads all shards; the sharded layout requires the manifest
+            shardStamps.clear();
+            if (!writeManifest())
+            {
+                warn("could not write " + getManifestFile());
+                return false;
+            }
+            // the layout switches with the rename, the journal is already contained in the shards
+            if (std::rename(getInfoFile().c_str(), (getInfoFile() + ".migrated").c_str()) != 0)
+            {
+                warn("could not rename " + getInfoFile());
+                return false;
+            }
+            std::remove(getJournalFile().c_str());
+        }
+        else
+        {
+            // the layout switches as soon as info.yml exists
+            if (!writeInfo())
+            {
+                warn("could not write " + getInfoFile());
+                return false;
+            }
+            for (const auto &name : modelOrder)
+            {
+                std::remove(getShardFile(name).c_str());
+            }
+            std::remove(getManifestFile().c_str());
+        }
+        invalidateInfo();
+        return loadInfo();
+    }
+
+    bool FileDB::writeInfo()
+    {
+        std::string file = "info.yml";
+        handleFilenamePrefix(&file, dbAddress);
+        std::string data;
+        if (!FileCompression::compress(compression, info.toYamlString(), &data) ||
+            !writeFileAtomic(file + FileCompression::getExtension(compression), data))
+        {
+            return false;
+        }
+        // the other forms would be read in favour of the new one
+        for (FileCompression::Format format : {FileCompression::NONE, FileCompression::GZIP, FileCompression::ZSTD})
+        {
+            if (format != compression)
+            {
+                std::remove((file + FileCompression::getExtension(format)).c_str());
+            }
+        }
+        if (!getFileStamp(file + FileCompression::getExtension(compression), &infoStamp))
+        {
+            invalidateInfo();
+            return false;
+        }
+        return true;
+    }
+
+    void FileDB::resolveDomains()
+    {
+        if (!resolvedDomainsLoaded)
+        {
+            // one record per model: name, its first version, stamp of the version file and the domain
+            resolvedDomainsLoaded = true;
+            std::string content;
+            if (readFile(getDomainFile(), &content))
+            {
+                size_t start = 0;
+                for (size_t end = content.find('\n'); end != std::string::npos; start = end + 1, end = content.find('\n', start))
+                {
+                    std::vector<std::string> fields = splitRecord(content.substr(start, end - start));
+                    ResolvedDomain resolved;
+                    if (fields.size() != 4 || !stringToStamp(fields[2], &resolved.stamp))
+                    {
+                        continue;
+                    }
+                    resolved.version = fields[1];
+                    resolved.domain = fields[3];
+                    resolvedDomains[fields[0]] = std::move(resolved);
+                }
+            }
+        }
+
+        bool changed = false;
+        std::set<std::string> used;
+        for (const auto &name : modelOrder)
+        {
+            ModelEntry &entry = modelIndex[name];
+            if (!entry.domain.empty())
+            {
+                continue;
+            }
+            std::string domain;
+            std::string file;
+            FileStamp stamp;
+            if (!entry.versions.empty() && getVersionFile(name, entry.versions.front(), &file, &stamp))
+            {
+                const std::string &version = entry.versions.front();
+                used.insert(name);
+                auto cached = resolvedDomains.find(name);
+                if (cached != resolvedDomains.end() && cached->second.version == version && cached->second.stamp == stamp)
+                {
+                    domain = cached->second.domain;
+                }
+                else
+                {
+                    if (fs::path(file).filename() == "model.yml")
+                    {
+                        domain = scanDomain(file);
+                    }
+                    else
+                    {
+                        // compressed, json, deduplicated or delta version
+                        ConfigMap map;
+                        std::string error;
+                        if (readRawVersion(name, version, &map, &stamp, &error) && map.hasKey("domain"))
+                        {
+                            domain = map["domain"].getString();
+                        }
+                    }
+                    if (domain.empty())
+                    {
+                        domain = defaultDomain;
+                    }
+                    resolvedDomains[name] = ResolvedDomain{version, stamp, domain};
+                    changed = true;
+                }
+            }
+            entry.domain = domain.empty() ? defaultDomain : domain;
+            // reaches info.yml with the next compaction
+            info["models"][entry.infoPosition]["domain"] = entry.domain;
+        }
+        for (auto it = resolvedDomains.begin(); it != resolvedDomains.end();)
+        {
+            if (used.count(it->first))
+            {
+                ++it;
+                continue;
+            }
+            it = resolvedDomains.erase(it);
+            changed = true;
+        }
+        if (!changed)
+        {
+            return;
+        }
+        std::string content;
+        for (const auto &it : resolvedDomains)
+        {
+            content += escapeField(it.first) + "\t" + escapeField(it.second.version) + "\t" +
+                       stampToString(it.second.stamp) + "\t" + escapeField(it.second.domain) + "\n";
+        }
+        // a read-only database resolves the domains again on each load
+        writeFileAtomic(getDomainFile(), content);
+    }
+
+    void FileDB::buildDomainIndex()
+    {
+        domainModels.clear();
+        for (const auto &name : modelOrder)
+        {
+            domainModels[modelIndex[name].domain].push_back(name);
+        }
+    }
+
+    void FileDB::buildIndex()
+    {
+        ++indexGeneration;
+        modelIndex.clear();
+        modelOrder.clear();
+        modelIndex.reserve(info["models"].size());
+        size_t i = 0;
+        for (auto &it : info["models"])
+        {
+            const std::string name = it["name"];
+            // like the linear search before, the first entry of a model wins
+            auto result = modelIndex.emplace(name, ModelEntry());
+            if (result.second)
+            {
+                ModelEntry &entry = result.first->second;
+                entry.type = it["type"].getString();
+                if (it.hasKey("domain"))
+                {
+                    entry.domain = it["domain"].getString();
+                }
+                entry.infoPosition = i;
+                for (auto &it2 : it["versions"])
+                {
+                    entry.versions.push_back(it2["name"]);
+                }
+                entry.sortedVersions = entry.versions;
+                std::sort(entry.sortedVersions.begin(), entry.sortedVersions.end());
+                modelOrder.push_back(name);
+            }
+            ++i;
+        }
+    }
+
+    const FileDB::ModelEntry *FileDB::findModel(const std::string &model) const
+    {
+        auto it = modelIndex.find(model);
+        if (it == modelIndex.end())
+        {
+            return nullptr;
+        }
+        return &(it->second);
+    }
+
+    std::vector<std::pair<std::string, std::string>> FileDB::requestModelListByDomain(const std::string &domain)
+    {
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
+        std::vector<std::pair<std::string, std::string>> modelList;
+
+        // return content of info.yml
+        if (loadInfo())
+        {
+            const std::vector<std::string> *models = &modelOrder;
+            if (!domain.empty())
+            {
+                auto it = domainModels.find(domain);
+                if (it == domainModels.end())
+                {
+                    return {};
+                }
+                models = &(it->second);
+            }
+            modelList.reserve(models->size());
+            for (const auto &name : *models)
+            {
+                modelList.push_back(std::make_pair(name, modelIndex[name].type));
+            }
+
+            return modelList;
+        }
+        else 
+        {
+            warn(getInfoFile() + " doesn't exist");
+            return {};
+        }
+    }
+
+    std::vector<std::string> FileDB::requestVersions(const std::string &domain, const std::string &model)
+    {
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
+        // return content of info.yml
+        if (loadInfo())
+        {
+            if (const ModelEntry *entry = findModel(model))
+            {
+                return entry->versions;
+            }
+            return {};
+        }
+        else 
+        {
+            warn(getInfoFile() + " doesn't exist");
+            return {};
+        }
+    }
+
+    ConfigMap FileDB::requestModel(const std::string &domain,
+                                   const std::string &model,
+                                   const std::string &version,
+                                   const bool limit)
+    {
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
+        if (limit)
+        {
+            return loadVersion(model, version);
+        }
+        return requestModelLazy(domain, model).toConfigMap();
+    }
+
+    LazyModel FileDB::requestModelLazy(const std::string &domain, const std::string &model)
+    {
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
+        // get available versions
+        std::vector<std::string> versionList;
+        if (loadInfo())
+        {
+            if (const ModelEntry *entry = findModel(model))
+            {
+                versionList = entry->versions;
+            }
+        }
+        else 
+        {
+            warn(getInfoFile() + " doesn't exist");
+        }
+        return LazyModel(
+            versionList,
+            [this, model](const std::string &version)
+            { return loadVersion(model, version); },
+            [this, model](const std::vector<std::string> &versions)
+            { return loadVersions(model, versions); });
     }
 
-    FileDB::~FileDB()
+    std::vector<ConfigMap> FileDB::requestModels(const std::vector<std::tuple<std::string, std::string, std::string>> &models)
     {
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
+        // the domain is not part of the file layout, so only model and version identify a file
+        std::vector<std::pair<std::string, std::string>> files;
+        std::map<std::pair<std::string, std::string>, size_t> fileIndex;
+        std::vector<size_t> requestToFile;
+        requestToFile.reserve(models.size());
+        for (const auto &it : models)
+        {
+            auto key = std::make_pair(std::get<1>(it), std::get<2>(it));
+            auto result = fileIndex.emplace(key, files.size());
+            if (result.second)
+            {
+                files.push_back(key);
+            }
+            requestToFile.push_back(result.first->second);
+        }
+        std::vector<ConfigMap> maps = readVersions(files);
+        std::vector<ConfigMap> result;
+        result.reserve(models.size());
+        for (size_t i : requestToFile)
+        {
+            result.push_back(maps[i]);
+        }
+        return result;
     }
 
-    std::vector<std::pair<std::string, std::string>> FileDB::requestModelListByDomain(const std::string &domain)
+    ConfigMap FileDB::loadVersion(const std::string &model, const std::string &version)
     {
-        std::vector<std::pair<std::string, std::string>> modelList;
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
+        ConfigMap map;
+        std::string error;
+        if (!readVersion(model, version, &map, &error))
+        {
+            warn(error);
+        }
+        return map;
+    }
 
-        // return content of info.yml
-        std::string file = "info.yml";
-        handleFilenamePrefix(&file, dbAddress);
-        if (mars::utils::pathExists(file))
+    std::vector<ConfigMap> FileDB::loadVersions(const std::string &model, const std::vector<std::string> &versions)
+    {
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
+        std::vector<std::pair<std::string, std::string>> files;
+        files.reserve(versions.size());
+        for (const auto &version : versions)
         {
-            ConfigMap info = ConfigMap::fromYamlFile(file);
-            for (auto it : info["models"])
-            {
-                modelList.push_back(std::make_pair(it["name"], it["type"]));
-            }
+            files.push_back(std::make_pair(model, version));
+        }
+        return readVersions(files);
+    }
 
-            return modelList;
+    bool FileDB::readVersion(const std::string &model, const std::string &version,
+                             ConfigMap *map, std::string *error) const
+    {
+        if (model.empty() || version.empty())
+        {
+            *error = "no version of model \"" + model + "\" found";
+            return false;
         }
-        else 
+        FileStamp stamp;
+        if (!readRawVersion(model, version, map, &stamp, error))
         {
-            QMessageBox::warning(nullptr, "Warning",  QString::fromStdString(file + " doesn't exist"), QMessageBox::Ok);
-            return {};
+            return false;
         }
+        BasicModelHelper::convertFromLegacyModelFormat(*map);
+        (*map)["uri"] = getUri(map->hasKey("domain") ? (*map)["domain"].getString() : "", model, version);
+        return true;
     }
 
-    std::vector<std::string> FileDB::requestVersions(const std::string &domain, const std::string &model)
+    bool FileDB::getVersionFile(const std::string &model, const std::string &version, std::string *file, FileStamp *stamp) const
     {
-        std::vector<std::string> versionList;
+        // a deduplicated version has a model.ref, blobs never change so the stamp of the reference is sufficient;
+        // a delta version only changes with its file as well, its base is stored completely before it changes
+        for (const char *name : versionFiles)
+        {
+            *file = model + "/" + version + "/" + name;
+            handleFilenamePrefix(file, dbAddress);
+            if (getFileStamp(*file, stamp))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
 
-        // return content of info.yml
-        std::string file = "info.yml";
-        handleFilenamePrefix(&file, dbAddress);
-        if (mars::utils::pathExists(file))
+    bool FileDB::readRawVersion(const std::string &model, const std::string &version,
+                                ConfigMap *map, FileStamp *stamp, std::string *error, size_t depth) const
+    {
+        std::string file;
+        FileDBSnapshot::Stamp packedStamp;
+        const std::string key = model + "/" + version;
+        bool verified = false;
+        size_t generation = 0;
+        if (isWatching() && snapshot.isOpen())
+        {
+            std::lock_guard<std::mutex> lock(watchMutex);
+            verified = verifiedVersions.count(key) > 0;
+            generation = changeGeneration;
+        }
+        if (verified && snapshot.findVersion(model, version, map, &packedStamp))
         {
-            ConfigMap info = ConfigMap::fromYamlFile(file);
-            for (auto it : info["models"])
+            // the watcher reported no change since the file matched the snapshot
+            stamp->device = packedStamp.device;
+            stamp->inode = packedStamp.inode;
+            stamp->size = packedStamp.size;
+            stamp->mtime.tv_sec = packedStamp.sec;
+            stamp->mtime.tv_nsec = packedStamp.nsec;
+            return true;
+        }
+        if (!getVersionFile(model, version, &file, stamp))
+        {
+            file = model + "/" + version + "/model.yml";
+            handleFilenamePrefix(&file, dbAddress);
+            *error = file + " doesn't exist";
+            return false;
+        }
+        if (snapshot.findVersion(model, version, map, &packedStamp) && packedStamp == toSnapshotStamp(*stamp))
+        {
+            if (isWatching())
             {
-                if (it["name"] == model)
+                std::lock_guard<std::mutex> lock(watchMutex);
+                // a change reported while checking could be newer than the stamp
+                if (generation == changeGeneration)
                 {
-                    for (auto it2 : it["versions"])
-                    {
-                        versionList.push_back(it2["name"]);
-                    }
-                    break;
+                    verifiedVersions.insert(key);
                 }
             }
-            return versionList;
+            return true;
         }
-        else 
+        const std::string extension = fs::path(file).extension().string();
+        if (extension == ".ref" || extension == ".delta")
         {
-            QMessageBox::warning(nullptr, "Warning",  QString::fromStdString(file + " doesn't exist"), QMessageBox::Ok);
-            return {};
+            if (!(extension == ".ref" ? readRef(file, map, error) : readDelta(model, file, map, error, depth)))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            *map = readConfigFile(file);
         }
+        FileStamp after;
+        if (!getFileStamp(file, &after) || after != *stamp)
+        {
+            *error = file + " changed while reading it";
+            return false;
+        }
+        return true;
     }
 
-    ConfigMap FileDB::requestModel(const std::string &domain,
-                                   const std::string &model,
-                                   const std::string &version,
-                                   const bool limit)
+    bool FileDB::writeSnapshot(size_t *numVersions)
     {
-        std::vector<std::string> versionList;
-        if (limit)
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
+        if (!loadInfo())
         {
-            versionList.push_back(version);
+            warn(getInfoFile() + " doesn't exist");
+            return false;
         }
-        else
+        std::vector<FileDBSnapshot::Entry> entries;
+        for (const auto &name : modelOrder)
         {
-            // get available versions
-            std::string file = "info.yml";
-            handleFilenamePrefix(&file, dbAddress);
-            if (mars::utils::pathExists(file))
+            for (const auto &version : modelIndex[name].versions)
             {
-                ConfigMap info = configmaps::ConfigMap::fromYamlFile(file);
-                for (auto it : info["models"])
-                {
-                    if (it["name"] == model)
-                    {
-                        for (auto it2 : it["versions"])
-                        {
-                            versionList.push_back(it2["name"]);
-                        }
-                        break;
-                    }
-                }
+                FileDBSnapshot::Entry entry;
+                entry.model = name;
+                entry.version = version;
+                entries.push_back(entry);
+            }
+        }
+        std::vector<std::string> errors(entries.size());
+        getLoadPool().parallelFor(entries.size(), [&](size_t i)
+                                  {
+            FileStamp stamp;
+            if (readRawVersion(entries[i].model, entries[i].version, &entries[i].content, &stamp, &errors[i]))
+            {
+                entries[i].stamp = toSnapshotStamp(stamp);
+            } });
+        // versions which cannot be read are left out and therefore read from yaml
+        std::vector<FileDBSnapshot::Entry> packed;
+        packed.reserve(entries.size());
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            if (errors[i].empty())
+            {
+                packed.push_back(std::move(entries[i]));
             }
-            else 
+            else
             {
-                QMessageBox::warning(nullptr, "Warning",  QString::fromStdString(file + " doesn't exist"), QMessageBox::Ok);
+                std::cerr << "FileDB: " << errors[i] << std::endl;
             }
         }
 
+        FileDBSnapshot::IndexState state;
+        state.info = toSnapshotStamp(infoStamp);
+        state.journalExists = journalExists;
+        state.journal = toSnapshotStamp(journalStamp);
+        state.journalValidSize = journalValidSize;
+        state.journalRecords = journalRecords;
+        if (!writeFileAtomic(getSnapshotFile(), FileDBSnapshot::encode(info, state, packed)))
+        {
+            warn("could not write " + getSnapshotFile());
+            return false;
+        }
+        if (numVersions)
+        {
+            *numVersions = packed.size();
+        }
+        return true;
+    }
 
-        bool first = true;
-        ConfigMap result;
-        for (auto it : versionList)
+    bool FileDB::getVersionStamp(const std::string &model, const std::string &version, FileDBSnapshot::Stamp *stamp)
+    {
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
+        std::string file;
+        FileStamp fileStamp;
+        if (!getVersionFile(model, version, &file, &fileStamp))
         {
-            std::string file = model + "/" + it + "/model.yml";
-            handleFilenamePrefix(&file, dbAddress);
-            if (mars::utils::pathExists(file))
+            return false;
+        }
+        *stamp = toSnapshotStamp(fileStamp);
+        return true;
+    }
+
+    std::vector<ConfigMap> FileDB::readVersions(const std::vector<std::pair<std::string, std::string>> &files)
+    {
+        std::vector<ConfigMap> maps(files.size());
+        std::vector<std::string> errors(files.size());
+        getLoadPool().parallelFor(files.size(), [&](size_t i)
+                                  {
+            // a broken file only fails its own entry, parallelFor would drop the whole batch
+            try
             {
-                ConfigMap map = configmaps::ConfigMap::fromYamlFile(file);
-                if (first)
+                if (!readVersion(files[i].first, files[i].second, &maps[i], &errors[i]))
                 {
-                    result = map;
-                    first = false;
-                }
-                else
-                {
-                    result["versions"].push_back(map["versions"][0]);
+                    maps[i] = ConfigMap();
                 }
             }
-            else
+            catch (const std::exception &e)
             {
-                QMessageBox::warning(nullptr, "Warning",  QString::fromStdString(file + " doesn't exist"), QMessageBox::Ok);
+                maps[i] = ConfigMap();
+                errors[i] = "could not read " + files[i].first + "/" + files[i].second + ": " + e.what();
+            } });
+        // one dialog for the whole batch instead of one per missing file
+        for (const auto &error : errors)
+        {
+            if (!error.empty())
+            {
+                warn(error);
                 break;
             }
         }
-        BasicModelHelper::convertFromLegacyModelFormat(result);
-        return result;
+        return maps;
     }
 
     bool FileDB::storeModel(const ConfigMap &map_)
     {
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
         ConfigMap map = map_;
+        // the uri is derived from the location, it is not part of the stored model
+        map.erase("uri");
         BasicModelHelper::convertToLegacyModelFormat(map);
 
         std::string model = map["name"];
         std::string type = map["type"];
         std::string version = map["versions"][0]["name"];
+        std::string domain = map.hasKey("domain") ? map["domain"].getString() : std::string("");
 
-        // add to indexing
-        std::string file = "info.yml";
-        handleFilenamePrefix(&file, dbAddress);
-        ConfigMap info;
-        if (mars::utils::pathExists(file))
+        if (!loadInfo())
         {
-            info = ConfigMap::fromYamlFile(file);
+            warn(getInfoFile() + " doesn't exist");
+            return false;
         }
-        else
+        if (domain.empty())
+        {
+            // a model stored without domain stays where it is listed, only new ones go to the default domain
+            const ModelEntry *listed = findModel(model);
+            domain = listed && !listed->domain.empty() ? listed->domain : std::string(defaultDomain);
+        }
+
+        // the newest version so far becomes a delta against a new version, an older delta
+        // against an existing version has to be complete before that version changes
+        std::string previous;
+        const ModelEntry *known = findModel(model);
+        if (known && known->hasVersion(version))
+        {
+            if (!materializeDependent(model, version))
+            {
+                return false;
+            }
+        }
+        else if (known && !known->versions.empty() && deltaKeyframeInterval > 1)
+        {
+            previous = known->versions.back();
+        }
+
+        // write the model first, so the index never references a missing file
+        std::string folder = model + "/" + version;
+        handleFilenamePrefix(&folder, dbAddress);
+        createDirectory(folder);
+        if (!writeVersionFiles(folder, map, deduplicate))
         {
-            QMessageBox::warning(nullptr, "Warning",  QString::fromStdString(file + " doesn't exist"), QMessageBox::Ok);
+            warn("could not write " + folder);
             return false;
         }
-        bool foundModel = false;
-        bool foundVersion = false;
-        size_t i = 0;
-        size_t modelIndex = 0;
-        for (auto it : info["models"])
+
+        // add to indexing
+        const ModelEntry *entry = findModel(model);
+        if ((!entry || !entry->hasVersion(version) || entry->domain != domain) && sharded)
+        {
+            // only the shard of the model is written, manifest.yml follows lazily
+            bool written = updateShard(model, [&](ConfigMap &shard)
+                                       {
+                if (!shard.hasKey("type"))
+                {
+                    shard["type"] = type;
+                }
+                shard["domain"] = domain;
+                if (shard.hasKey("versions"))
+                {
+                    for (auto &it : shard["versions"])
+                    {
+                        if (it["name"].getString() == version)
+                        {
+                            return;
+                        }
+                    }
+                }
+                ConfigMap versionMap;
+                versionMap["name"] = version;
+                shard["versions"].push_back(versionMap); });
+            if (!written)
+            {
+                warn("could not write " + getShardFile(model));
+                return false;
+            }
+            applyAdd(model, type, version, domain);
+        }
+        else if (!entry || !entry->hasVersion(version) || entry->domain != domain)
+        {
+            if (!appendJournal({"add", model, type, version, domain}))
+            {
+                warn("could not write " + getJournalFile());
+                return false;
+            }
+            applyAdd(model, type, version, domain);
+            if (journalRecords >= journalCompactionThreshold && !compact())
+            {
+                // the journal still holds the change, compaction is retried with the next store
+                warn("could not compact " + getInfoFile());
+            }
+        }
+        if (!previous.empty() && !storeAsDelta(model, previous, version))
+        {
+            // the version stays complete, which only costs space
+            std::cerr << "FileDB: could not store " << model << "/" << previous << " as delta" << std::endl;
+        }
+        if (dependenciesLoaded)
+        {
+            // the stored map is known, so the version needs no rescan; .dependencies is written with the next request
+            std::string file;
+            FileStamp stamp;
+            if (getVersionFile(model, version, &file, &stamp))
+            {
+                VersionDependencies &entry = dependencies[std::make_pair(model, version)];
+                entry.stamp = stamp;
+                entry.uses = BasicModelHelper::getComponentModels(map);
+                dependentsValid = false;
+                dependenciesUnsaved = true;
+            }
+            auto it = dependencies.find(std::make_pair(model, previous));
+            if (it != dependencies.end() && getVersionFile(model, previous, &file, &stamp))
+            {
+                // a delta has the content of the complete version it replaced
+                it->second.stamp = stamp;
+                dependenciesUnsaved = true;
+            }
+        }
+        return true;
+    }
+
+    void FileDB::updateDependencies()
+    {
+        if (!dependenciesLoaded)
         {
-            if (it["name"] == model)
+            // one record per version: model, version, stamp of its file, then domain, name and version of each used model
+            dependenciesLoaded = true;
+            dependentsValid = false;
+            std::string content;
+            if (readFile(getDependencyFile(), &content))
             {
-                foundModel = true;
-                modelIndex = i;
-                for (auto it2 : it["versions"])
+                size_t start = 0;
+                for (size_t end = content.find('\n'); end != std::string::npos; start = end + 1, end = content.find('\n', start))
                 {
-                    if (it2["name"] == version)
+                    std::vector<std::string> fields = splitRecord(content.substr(start, end - start));
+                    VersionDependencies entry;
+                    if (fields.size() < 3 || (fields.size() - 3) % 3 != 0 || !stringToStamp(fields[2], &entry.stamp))
+                    {
+                        continue;
+                    }
+                    for (size_t i = 3; i < fields.size(); i += 3)
                     {
-                        foundVersion = true;
-                        break;
+                        entry.uses.emplace_back(fields[i], fields[i + 1], fields[i + 2]);
                     }
+                    dependencies[std::make_pair(fields[0], fields[1])] = std::move(entry);
                 }
-                break;
             }
-            ++i;
         }
-        if (!foundModel)
+
+        // the index only has to be compared with the dependencies if it changed since the last request
+        const bool indexChanged = indexGeneration != dependenciesIndexGeneration;
+        dependenciesIndexGeneration = indexGeneration;
+
+        // forget the versions which were removed
+        for (auto it = dependencies.begin(); indexChanged && it != dependencies.end();)
         {
-            ConfigMap modelMap;
-            modelMap["name"] = model;
-            modelMap["type"] = type;
-            modelIndex = info["models"].size();
-            info["models"].push_back(modelMap);
+            const ModelEntry *entry = findModel(it->first.first);
+            if (!entry || !entry->hasVersion(it->first.second))
+            {
+                it = dependencies.erase(it);
+                dependentsValid = false;
+                dependenciesUnsaved = true;
+            }
+            else
+            {
+                ++it;
+            }
         }
-        if (!foundVersion)
+
+        // all files are checked against their stamps once; afterwards storeModel() keeps the entries current, so
+        // only new versions and, with the watcher, the versions of models reported as changed are checked
+        std::vector<std::pair<std::string, std::string>> check;
+        size_t generation = 0;
+        bool checkAll = false;
         {
-            ConfigMap modelMap;
-            modelMap["name"] = version;
-            info["models"][modelIndex]["versions"].push_back(modelMap);
-            info.toYamlFile(file);
+            std::lock_guard<std::mutex> lock(watchMutex);
+            generation = changeGeneration;
+            checkAll = !dependencyStampsChecked;
+            const bool filesChanged = isWatching() && generation != dependenciesChangeGeneration;
+            for (size_t i = 0; i < modelOrder.size() && (checkAll || indexChanged || filesChanged); ++i)
+            {
+                const std::string &name = modelOrder[i];
+                for (const auto &version : modelIndex[name].versions)
+                {
+                    if (checkAll || !dependencies.count(std::make_pair(name, version)) ||
+                        (isWatching() && !verifiedDependencies.count(name + "/" + version)))
+                    {
+                        check.emplace_back(name, version);
+                    }
+                }
+            }
+        }
+        std::vector<std::pair<std::string, std::string>> stale;
+        std::vector<std::string> verified;
+        for (const auto &key : check)
+        {
+            std::string file;
+            FileStamp stamp;
+            if (!getVersionFile(key.first, key.second, &file, &stamp))
+            {
+                // a missing file is reported when the version is loaded
+                continue;
+            }
+            auto it = dependencies.find(key);
+            if (it != dependencies.end() && it->second.stamp == stamp)
+            {
+                verified.push_back(key.first + "/" + key.second);
+            }
+            else
+            {
+                stale.push_back(key);
+            }
+        }
+        std::vector<ConfigMap> maps(stale.size());
+        std::vector<FileStamp> stamps(stale.size());
+        std::vector<char> read(stale.size(), 0);
+        getLoadPool().parallelFor(stale.size(), [&](size_t i)
+                                  {
+            std::string error;
+            read[i] = readRawVersion(stale[i].first, stale[i].second, &maps[i], &stamps[i], &error); });
+        for (size_t i = 0; i < stale.size(); ++i)
+        {
+            if (!read[i])
+            {
+                // not indexed until it can be read
+                dependencies.erase(stale[i]);
+                continue;
+            }
+            VersionDependencies &entry = dependencies[stale[i]];
+            entry.stamp = stamps[i];
+            entry.uses = BasicModelHelper::getComponentModels(maps[i]);
+            verified.push_back(stale[i].first + "/" + stale[i].second);
+        }
+        if (!stale.empty())
+        {
+            dependentsValid = false;
+            dependenciesUnsaved = true;
+        }
+        {
+            std::lock_guard<std::mutex> lock(watchMutex);
+            // a change reported while checking could be newer than the stamps
+            if (generation == changeGeneration)
+            {
+                if (isWatching())
+                {
+                    verifiedDependencies.insert(verified.begin(), verified.end());
+                }
+                dependenciesChangeGeneration = generation;
+                dependencyStampsChecked = dependencyStampsChecked || checkAll;
+            }
         }
 
-        std::string folder = model + "/" + version;
-        handleFilenamePrefix(&folder, dbAddress);
-        createDirectory(folder);
-        file = folder + "/model.yml";
-        map.toYamlFile(file);
-        return true;
+        if (dependenciesUnsaved)
+        {
+            writeDependencies();
+        }
+        if (!dependentsValid)
+        {
+            dependents.clear();
+            for (const auto &it : dependencies)
+            {
+                for (const auto &used : it.second.uses)
+                {
+                    std::vector<std::pair<std::string, std::string>> &users = dependents[std::get<1>(used)];
+                    if (users.empty() || users.back() != it.first)
+                    {
+                        users.push_back(it.first);
+                    }
+                }
+            }
+            dependentsValid = true;
+        }
+    }
+
+    void FileDB::writeDependencies()
+    {
+        std::string content;
+        for (const auto &it : dependencies)
+        {
+            content += escapeField(it.first.first) + "\t" + escapeField(it.first.second) + "\t" + stampToString(it.second.stamp);
+            for (const auto &used : it.second.uses)
+            {
+                content += "\t" + escapeField(std::get<0>(used)) + "\t" + escapeField(std::get<1>(used)) +
+                           "\t" + escapeField(std::get<2>(used));
+            }
+            content += "\n";
+        }
+        // a read-only database keeps the index in memory only
+        if (writeFileAtomic(getDependencyFile(), content))
+        {
+            dependenciesUnsaved = false;
+        }
+    }
+
+    std::vector<std::tuple<std::string, std::string, std::string>> FileDB::requestDependents(const std::string &domain,
+                                                                                            const std::string &model,
+                                                                                            const std::string &version)
+    {
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
+        std::vector<std::tuple<std::string, std::string, std::string>> result;
+        if (!loadInfo())
+        {
+            return result;
+        }
+        updateDependencies();
+        auto users = dependents.find(model);
+        if (users == dependents.end())
+        {
+            return result;
+        }
+        for (const auto &user : users->second)
+        {
+            for (const auto &used : dependencies[user].uses)
+            {
+                if (std::get<1>(used) == model && (domain.empty() || std::get<0>(used) == domain) &&
+                    (version.empty() || std::get<2>(used) == version))
+                {
+                    const ModelEntry *entry = findModel(user.first);
+                    result.emplace_back(entry ? entry->domain : std::string(""), user.first, user.second);
+                    break;
+                }
+            }
+        }
+        return result;
     }
 
     void FileDB::setDbAddress(const std::string &db_Address)
     {
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
         dbAddress = db_Address;
+        invalidateInfo();
+        dependencies.clear();
+        dependents.clear();
+        dependenciesLoaded = false;
+        dependentsValid = false;
+        dependenciesUnsaved = false;
+        {
+            std::lock_guard<std::mutex> watchLock(watchMutex);
+            dependencyStampsChecked = false;
+        }
+        resolvedDomains.clear();
+        resolvedDomainsLoaded = false;
+        snapshot.close();
+        setWatchChanges(watchChanges);
     }
 
     configmaps::ConfigMap FileDB::getPropertiesOfComponentModel()
@@ -224,7 +2620,15 @@ namespace xrock_gui_model
         propMap["type"]["type"] = "string";
         propMap["domain"]["value"] = "";
         propMap["domain"]["type"] = "array";
-        propMap["domain"]["allowed_values"][0] = "SOFTWARE";
+        std::vector<std::string> domains = getDomains();
+        if (std::find(domains.begin(), domains.end(), defaultDomain) == domains.end())
+        {
+            domains.insert(domains.begin(), defaultDomain);
+        }
+        for (const auto &domain : domains)
+        {
+            propMap["domain"]["allowed_values"].push_back(ConfigItem(domain));
+        }
         propMap["project"]["value"] = "";
         propMap["project"]["type"] = "string";
         return propMap;
@@ -232,8 +2636,19 @@ namespace xrock_gui_model
 
     std::vector<std::string> FileDB::getDomains()
     {
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
         std::vector<std::string> domains;
-        domains.push_back("SOFTWARE");
+        if (loadInfo())
+        {
+            for (const auto &it : domainModels)
+            {
+                domains.push_back(it.first);
+            }
+        }
+        if (domains.empty())
+        {
+            domains.push_back(defaultDomain);
+        }
         return domains;
     }
 
@@ -7,31 +7,359 @@
 #pragma once
 #include <configmaps/ConfigMap.hpp>
 #include "DBInterface.hpp"
+#include "FileCompression.hpp"
+#include "FileDBSnapshot.hpp"
+#include "FileDBWatcher.hpp"
+
+#include <sys/stat.h>
+#include <atomic>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_map>
 
 namespace xrock_gui_model
 {
+    class ThreadPool;
 
     class FileDB : public DBInterface
     {
 
     public:
-        FileDB();
+        // numLoadThreads: threads used to read model files in parallel, 0 selects a default
+        explicit FileDB(size_t numLoadThreads = 0);
         ~FileDB();
 
+        // An empty domain lists the models of all domains
         std::vector<std::pair<std::string, std::string>> requestModelListByDomain(const std::string &domain) override;
         std::vector<std::string> requestVersions(const std::string &domain, const std::string &model) override;
         configmaps::ConfigMap requestModel(const std::string &domain,
                                            const std::string &model,
                                            const std::string &version,
                                            const bool limit = false) override;
+        LazyModel requestModelLazy(const std::string &domain, const std::string &model) override;
+        // Reads each distinct model version once, in parallel on the load pool
+        std::vector<configmaps::ConfigMap> requestModels(const std::vector<std::tuple<std::string, std::string, std::string>> &models) override;
+        // Answered from .dependencies, an index of the components of every version. The files are compared with
+        // it once, then storeModel() keeps it up to date and only new versions are read. Without the watcher, a
+        // version overwritten in place by another process is only noticed by the next FileDB instance.
+        std::vector<std::tuple<std::string, std::string, std::string>> requestDependents(const std::string &domain,
+                                                                                        const std::string &model,
+                                                                                        const std::string &version) override;
         bool storeModel(const configmaps::ConfigMap &map_) override;
-        bool removeModel(const std::string &uri) override { return false; }
+        // Removes a version ("filedb://<domain>/<model>/<version>") or all versions ("filedb://<domain>/<model>")
+        bool removeModel(const std::string &uri) override;
         void setDbAddress(const std::string & db_Address) override;
         virtual configmaps::ConfigMap getPropertiesOfComponentModel() override;
+        // Domains of the models in the database, SOFTWARE if it is empty
         virtual std::vector<std::string> getDomains() override;
         virtual configmaps::ConfigMap getEmptyComponentModel() override;
+        int addChangeListener(ChangeListener listener) override;
+        void removeChangeListener(int id) override;
+
+        // Watch the database directory for changes instead of checking the files on every access (Linux only)
+        void setWatchChanges(bool watch);
+
+        // Number of index requests served from the cached info.yml / that had to (re-)parse it
+        size_t getIndexCacheHits() const { return indexCacheHits; }
+        size_t getIndexCacheMisses() const { return indexCacheMisses; }
+
+        static std::string getUri(const std::string &domain, const std::string &model, const std::string &version);
+        // Splits a uri created by getUri(), the version is empty if the uri names a whole model
+        static bool parseUri(const std::string &uri, std::string *domain, std::string *model, std::string *version);
+
+        // Packs the index and all model files into snapshot.xpack, which is used
+        // instead of the yaml files as long as they do not change
+        bool writeSnapshot(size_t *numVersions = nullptr);
+        // Stamp of the file holding a version, it changes with every change of the version.
+        // Returns false if the version has no file.
+        bool getVersionStamp(const std::string &model, const std::string &version, FileDBSnapshot::Stamp *stamp);
+        std::string getDbAddress() const { return dbAddress; }
+
+        // Writes the content to a temporary file and renames it, so readers never see a partial file
+        static bool writeFileAtomic(const std::string &file, const std::string &content);
+
+        // Folds the index journal into info.yml and removes the journal,
+        // rewrites manifest.yml for the sharded layout
+        bool compact();
+        // Number of journal records after which storeModel() compacts the index
+        void setJournalCompactionThreshold(size_t records) { journalCompactionThreshold = records; }
+
+        void setNumLoadThreads(size_t numThreads);
+        size_t getNumLoadThreads() const { return numLoadThreads; }
+
+        // A database uses the sharded layout if it has no info.yml but a manifest.yml. Then every model
+        // directory holds its own versions.yml and manifest.yml caches the content of all of them.
+        bool isSharded() const { return sharded; }
+        // Converts the database to the sharded or the single file layout. Other processes must not write meanwhile.
+        bool migrateLayout(bool toSharded);
+
+        // Stores the bodies of new versions once in .blobs/, keyed by a hash of the model without name, version
+        // name and date. The version directory then only holds a model.ref with these fields.
+        void setDeduplicate(bool deduplicate) { this->deduplicate = deduplicate; }
+        bool getDeduplicate() const { return deduplicate; }
+        // Moves the model.yml of every version into the blob store and deletes blobs which are no longer referenced.
+        // Other processes must not write meanwhile.
+        bool deduplicateVersions(size_t *numVersions = nullptr, size_t *numBlobs = nullptr);
+
+        // Stores the previous newest version as model.delta, the difference to the new one, when a version
+        // is added. The newest version and every interval-th one stay complete. 0 and 1 store all completely.
+        void setDeltaKeyframeInterval(size_t interval) { deltaKeyframeInterval = interval; }
+        size_t getDeltaKeyframeInterval() const { return deltaKeyframeInterval; }
+
+        // Compression of the model.yml and info.yml files written from now on. Compressed files
+        // (model.yml.gz, info.yml.zst, ...) are always read, a plain file is preferred if both exist.
+        void setCompression(FileCompression::Format format) { compression = format; }
+        FileCompression::Format getCompression() const { return compression; }
+
+        enum ModelFormat
+        {
+            YAML,
+            JSON
+        };
+        // Format of the model files written from now on. model.json (parsed faster) and model.yml are always read.
+        void setModelFormat(ModelFormat format) { modelFormat = format; }
+        ModelFormat getModelFormat() const { return modelFormat; }
+        // Format and compression of the first complete model file found, in the sharded layout without one
+        // YAML and NONE, else those of info.yml. Returns false if the database does not exist.
+        bool detectFileFormat(ModelFormat *format, FileCompression::Format *compression);
+        // Writes the complete versions and info.yml again in the current format and compression.
+        // Other processes must not write meanwhile.
+        bool rewriteModelFiles(size_t *numVersions = nullptr);
 
     private:
+        // Identifies the on-disk state of a file; a change of any field invalidates the cache
+        struct FileStamp
+        {
+            dev_t device = 0;
+            ino_t inode = 0;
+            off_t size = 0;
+            struct timespec mtime = {0, 0};
+
+            bool operator==(const FileStamp &other) const;
+            bool operator!=(const FileStamp &other) const { return !(*this == other); }
+        };
+
+        // Index entry of one model in info.yml
+        struct ModelEntry
+        {
+            std::string type;
+            std::string domain;
+            // position of the model in info["models"]
+            size_t infoPosition = 0;
+            // versions in the order of info.yml
+            std::vector<std::string> versions;
+            // same versions sorted for binary search
+            std::vector<std::string> sortedVersions;
+
+            bool hasVersion(const std::string &version) const;
+            void addVersion(const std::string &version);
+        };
+
         std::string dbAddress;
+        // Serializes the public functions, so the database can be used from a worker thread (see AsyncDB)
+        // while the GUI thread still calls it directly. Recursive because LazyModel loads re-enter.
+        std::recursive_mutex dbMutex;
+
+        // Parsed content of info.yml, only reloaded if the file changed on disk
+        configmaps::ConfigMap info;
+        FileStamp infoStamp;
+        bool infoValid;
+        size_t indexCacheHits;
+        size_t indexCacheMisses;
+        // info.journal: one line per index change since the last compaction, replayed on top of info.yml
+        FileStamp journalStamp;
+        bool journalExists;
+        // length of the journal up to the last complete record
+        off_t journalValidSize;
+        size_t journalRecords;
+        size_t journalCompactionThreshold;
+        // Domain of a model without one in the index, read from the file of its first version
+        struct ResolvedDomain
+        {
+            std::string version;
+            FileStamp stamp;
+            std::string domain;
+        };
+        // model -> resolved domain, loaded from .domains on first use; reused while the version file is unchanged
+        std::map<std::string, ResolvedDomain> resolvedDomains;
+        bool resolvedDomainsLoaded;
+        // Lookup structures derived from info, rebuilt whenever info is reloaded
+        std::unordered_map<std::string, ModelEntry> modelIndex;
+        std::vector<std::string> modelOrder;
+        // models of each domain in the order of info.yml
+        std::map<std::string, std::vector<std::string>> domainModels;
+
+        bool sharded;
+        // stamps of the versions.yml files the index was built from
+        std::map<std::string, FileStamp> shardStamps;
+        // stamps of manifest.yml and of the database directory when the shards were last checked; a shard
+        // write touches the manifest, so the shards are only listed again if one of them changed
+        FileStamp manifestStamp;
+        FileStamp shardDirStamp;
+        // number of shards which differ from manifest.yml, it is rewritten once enough differ
+        size_t manifestStaleShards;
+        static const size_t manifestRewriteThreshold = 64;
+        bool deduplicate;
+        size_t deltaKeyframeInterval;
+        FileCompression::Format compression;
+        ModelFormat modelFormat;
+        // complete versions read to reconstruct deltas, most recently used first
+        struct CachedVersion
+        {
+            std::string key;
+            FileStamp stamp;
+            configmaps::ConfigMap map;
+        };
+        static const size_t deltaCacheCapacity = 32;
+        mutable std::list<CachedVersion> deltaCache;
+        mutable std::mutex deltaCacheMutex;
+
+        // model/version pairs removed by journal records, their directories are moved to the trash
+        std::set<std::pair<std::string, std::string>> tombstones;
+        // deletes the trash directory in the background
+        std::thread reclaimThread;
+
+        bool watchChanges;
+        std::unique_ptr<FileDBWatcher> watcher;
+        // set by the watcher, the index is only checked again if this is set
+        std::atomic<bool> indexDirty;
+        // "model/version" of snapshot entries which matched their file and did not change since
+        mutable std::set<std::string> verifiedVersions;
+        // "model/version" of dependency entries which matched their file and did not change since
+        std::set<std::string> verifiedDependencies;
+        mutable std::mutex watchMutex;
+        // counts the notifications of the watcher, protected by watchMutex
+        size_t changeGeneration;
+        std::map<int, ChangeListener> listeners;
+        int nextListenerId;
+        std::mutex listenerMutex;
+
+        // Components used by one version, as domain, name and version of the used models
+        struct VersionDependencies
+        {
+            FileStamp stamp;
+            std::vector<std::tuple<std::string, std::string, std::string>> uses;
+        };
+        // model and version -> used models, loaded from .dependencies on first use
+        std::map<std::pair<std::string, std::string>, VersionDependencies> dependencies;
+        bool dependenciesLoaded;
+        // name of a used model -> model and version of its users, rebuilt from dependencies when they change
+        std::unordered_map<std::string, std::vector<std::pair<std::string, std::string>>> dependents;
+        bool dependentsValid;
+        // dependencies differ from .dependencies
+        bool dependenciesUnsaved;
+        // counts the changes of the index; the value it had when the dependencies were last compared with it
+        size_t indexGeneration;
+        size_t dependenciesIndexGeneration;
+        // changeGeneration when the dependencies were last checked, protected by watchMutex
+        size_t dependenciesChangeGeneration;
+        // all versions were compared with their stamps since .dependencies was loaded, protected by watchMutex
+        bool dependencyStampsChecked;
+
+        // optional packed copy of the database, only used for files whose stamps still match
+        FileDBSnapshot snapshot;
+
+        size_t numLoadThreads;
+        // created on first use, so FileDBs which never load in parallel spawn no threads
+        std::unique_ptr<ThreadPool> loadPool;
+
+        static bool getFileStamp(const std::string &file, FileStamp *stamp);
+        static FileDBSnapshot::Stamp toSnapshotStamp(const FileStamp &stamp);
+        // stamps of the shards are kept in manifest.yml as "device:inode:size:sec:nsec"
+        static std::string stampToString(const FileStamp &stamp);
+        static bool stringToStamp(const std::string &text, FileStamp *stamp);
+        std::string getInfoFile() const;
+        std::string getJournalFile() const;
+        std::string getSnapshotFile() const;
+        std::string getManifestFile() const;
+        std::string getBlobDirectory() const;
+        std::string getBlobFile(const std::string &id) const;
+        std::string getShardFile(const std::string &model) const;
+        std::string getDependencyFile() const;
+        std::string getDomainFile() const;
+        // (Re-)opens the snapshot if it was created or rebuilt since the last check
+        void updateSnapshot();
+        // Takes info and the journal state from the snapshot if it was built from the current files
+        bool loadInfoFromSnapshot(const FileStamp &stamp, bool journalExists, const FileStamp &journalStamp);
+        // Makes sure info holds the current content of info.yml and the journal. Returns false if info.yml does not exist.
+        bool loadInfo();
+        void replayJournal();
+        // loadInfo() for the sharded layout: starts from manifest.yml and reads the shards which changed since.
+        // Returns false if there is no manifest, a wrong path is not taken as an empty database.
+        bool loadShardedInfo();
+        bool writeManifest();
+        // Reads the shard of the model from disk, applies change and writes it back. A shard without versions is removed.
+        bool updateShard(const std::string &model, const std::function<void(configmaps::ConfigMap &)> &change);
+        // Appends one record and syncs it to disk
+        bool appendJournal(const std::vector<std::string> &fields);
+        // Adds the model version to info and the index if it is not known yet, an empty domain keeps the known one
+        void applyAdd(const std::string &model, const std::string &type, const std::string &version, const std::string &domain);
+        // Removes the version (or the whole model if version is empty) from info and the index
+        void applyRemove(const std::string &model, const std::string &version);
+        std::string getTrashDirectory() const;
+        // Moves the directories of removed versions, which are still in place, to the trash
+        void moveTombstonesToTrash();
+        bool moveToTrash(const std::string &path);
+        // Starts deleting the content of the trash directory in the background
+        void reclaimTrash();
+        // True while the watcher reports every change, the files need not be checked on access then
+        bool isWatching() const { return watcher && watcher->isActive(); }
+        // Called by the watcher thread
+        void handleChanges(bool indexChanged, const std::set<std::string> &models);
+        void invalidateInfo();
+        void buildIndex();
+        // Determines the domain of models which have none in info.yml (written by older versions) from their
+        // model files. Requests never write info.yml, the results are cached in .domains instead.
+        void resolveDomains();
+        void buildDomainIndex();
+        // Writes info to info.yml, the journal has to be removed afterwards
+        bool writeInfo();
+        const ModelEntry *findModel(const std::string &model) const;
+        // Loads model/version/model.yml and converts it from the legacy format. Returns an empty map on failure.
+        configmaps::ConfigMap loadVersion(const std::string &model, const std::string &version);
+        // Loads the versions of one model in parallel, in the given order
+        std::vector<configmaps::ConfigMap> loadVersions(const std::string &model, const std::vector<std::string> &versions);
+        // Thread-safe part of loadVersion: shows no dialog but returns the reason of a failure in error
+        bool readVersion(const std::string &model, const std::string &version,
+                         configmaps::ConfigMap *map, std::string *error) const;
+        // model.yml or model.json with the extension of the compression
+        std::string getVersionFileName() const;
+        // Writes model.yml (or model.json), or model.ref and the blob when deduplicating, and removes the other forms
+        bool writeVersionFiles(const std::string &folder, const configmaps::ConfigMap &map, bool asBlob);
+        // Writes the body of the model into the blob store unless an equal one exists and returns its id
+        bool writeBlob(const configmaps::ConfigMap &map, std::string *id);
+        // Reads the blob referenced by a model.ref and restores the fields kept in the reference
+        bool readRef(const std::string &file, configmaps::ConfigMap *map, std::string *error) const;
+        // Finds the file holding the version: model.yml, model.ref or model.delta
+        bool getVersionFile(const std::string &model, const std::string &version, std::string *file, FileStamp *stamp) const;
+        // Reconstructs a version from its model.delta and the base version. depth: number of deltas followed
+        // to get here; it fails if that reaches the run of the delta (a chain is shorter than its keyframe interval)
+        bool readDelta(const std::string &model, const std::string &file, configmaps::ConfigMap *map, std::string *error,
+                       size_t depth) const;
+        // readRawVersion() through the cache of the delta reconstruction
+        bool readCachedVersion(const std::string &model, const std::string &version,
+                               configmaps::ConfigMap *map, std::string *error, size_t depth) const;
+        // Replaces the complete version with the difference to base (its successor) unless it is due as keyframe
+        bool storeAsDelta(const std::string &model, const std::string &version, const std::string &base);
+        // Stores the predecessor of version completely if it is a delta against version, which is about to change
+        bool materializeDependent(const std::string &model, const std::string &version);
+        // Reads model.yml, model.ref or model.delta without conversion and fails if the file changes while reading.
+        // depth: number of deltas followed to reach the version, see readDelta()
+        bool readRawVersion(const std::string &model, const std::string &version,
+                            configmaps::ConfigMap *map, FileStamp *stamp, std::string *error, size_t depth = 0) const;
+        // Reads the given model files on the load pool and reports the first failure
+        std::vector<configmaps::ConfigMap> readVersions(const std::vector<std::pair<std::string, std::string>> &files);
+        ThreadPool &getLoadPool();
+        // Loads .dependencies, rescans new versions and those whose files changed, drops removed versions
+        // and writes the file again if anything changed
+        void updateDependencies();
+        void writeDependencies();
+        // Shows a warning dialog if called from the GUI thread, otherwise prints the warning
+        static void warn(const std::string &message);
     };
 } // end of namespace xrock_gui_model
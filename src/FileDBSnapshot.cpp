@@ -0,0 +1,477 @@
+/**
+ * \file FileDBSnapshot.cpp
+ * \brief Binary snapshot (.xpack) of a FileDB directory which is memory-mapped and decoded on demand
+ **/
+
+#include "FileDBSnapshot.hpp"
+
+#include <configmaps/ConfigVector.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace configmaps;
+
+namespace xrock_gui_model
+{
+
+    // Layout (all integers in host byte order, the magic doubles as byte order check):
+    //   header
+    //   string table: uint64 offsets[stringCount + 1] relative to the table end, then the characters
+    //   entry table: entryCount entries sorted by model and version name
+    //   trees: info and one per entry
+    // A tree node is a uint8 tag followed by
+    //   map:    uint32 size, size * (uint32 key string, node)
+    //   vector: uint32 size, size * node
+    //   atom:   uint32 string
+    namespace
+    {
+        const char magic[8] = {'X', 'P', 'A', 'C', 'K', 0, 0, 1};
+        const uint32_t formatVersion = 1;
+        const uint32_t byteOrderMark = 0x01020304;
+        const int maxDepth = 256;
+
+        enum Tag : uint8_t
+        {
+            TAG_EMPTY = 0,
+            TAG_MAP = 1,
+            TAG_VECTOR = 2,
+            TAG_ATOM = 3
+        };
+
+        struct PackedStamp
+        {
+            uint64_t device, inode, size;
+            int64_t sec, nsec;
+        };
+
+        struct Header
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t byteOrder;
+            uint64_t stringCount;
+            uint64_t stringTableOffset;
+            uint64_t entryCount;
+            uint64_t entryTableOffset;
+            uint64_t infoOffset;
+            PackedStamp info;
+            PackedStamp journal;
+            uint64_t journalExists;
+            uint64_t journalValidSize;
+            uint64_t journalRecords;
+        };
+
+        struct PackedEntry
+        {
+            uint32_t model;
+            uint32_t version;
+            uint64_t treeOffset;
+            PackedStamp stamp;
+        };
+
+        PackedStamp pack(const FileDBSnapshot::Stamp &s)
+        {
+            return PackedStamp{s.device, s.inode, s.size, s.sec, s.nsec};
+        }
+
+        FileDBSnapshot::Stamp unpack(const PackedStamp &p)
+        {
+            FileDBSnapshot::Stamp s;
+            s.device = p.device;
+            s.inode = p.inode;
+            s.size = p.size;
+            s.sec = p.sec;
+            s.nsec = p.nsec;
+            return s;
+        }
+
+        template <typename T>
+        void put(std::string *out, const T &value)
+        {
+            out->append(reinterpret_cast<const char *>(&value), sizeof(T));
+        }
+
+        template <typename T>
+        void putAt(std::string *out, size_t offset, const T &value)
+        {
+            memcpy(&(*out)[offset], &value, sizeof(T));
+        }
+
+        class StringTable
+        {
+        public:
+            uint32_t add(const std::string &s)
+            {
+                auto it = ids.emplace(s, strings.size());
+                if (it.second)
+                {
+                    strings.push_back(s);
+                }
+                return it.first->second;
+            }
+            const std::vector<std::string> &get() const { return strings; }
+
+        private:
+            std::map<std::string, uint32_t> ids;
+            std::vector<std::string> strings;
+        };
+
+        void encodeItem(ConfigItem &item, StringTable *strings, std::string *out)
+        {
+            if (item.isMap())
+            {
+                ConfigMap &map = item;
+                put<uint8_t>(out, TAG_MAP);
+                put<uint32_t>(out, map.size());
+                for (auto &it : map)
+                {
+                    put<uint32_t>(out, strings->add(it.first));
+                    encodeItem(it.second, strings, out);
+                }
+            }
+            else if (item.isVector())
+            {
+                ConfigVector &vector = item;
+                put<uint8_t>(out, TAG_VECTOR);
+                put<uint32_t>(out, vector.size());
+                for (auto &it : vector)
+                {
+                    encodeItem(it, strings, out);
+                }
+            }
+            else if (item.isAtom())
+            {
+                // atoms keep their text, like after parsing them from yaml
+                put<uint8_t>(out, TAG_ATOM);
+                put<uint32_t>(out, strings->add(item.toString()));
+            }
+            else
+            {
+                put<uint8_t>(out, TAG_EMPTY);
+            }
+        }
+
+        void encodeMap(ConfigMap &map, StringTable *strings, std::string *out)
+        {
+            put<uint8_t>(out, TAG_MAP);
+            put<uint32_t>(out, map.size());
+            for (auto &it : map)
+            {
+                put<uint32_t>(out, strings->add(it.first));
+                encodeItem(it.second, strings, out);
+            }
+        }
+    }
+
+    bool FileDBSnapshot::Stamp::operator==(const Stamp &other) const
+    {
+        return (device == other.device && inode == other.inode && size == other.size &&
+                sec == other.sec && nsec == other.nsec);
+    }
+
+    FileDBSnapshot::FileDBSnapshot() : data(nullptr), dataSize(0), stringCount(0), stringTableOffset(0),
+                                       entryCount(0), entryTableOffset(0), infoOffset(0)
+    {
+    }
+
+    FileDBSnapshot::~FileDBSnapshot()
+    {
+        close();
+    }
+
+    std::string FileDBSnapshot::encode(ConfigMap &info, const IndexState &state, std::vector<Entry> &entries)
+    {
+        std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b)
+                  { return a.model != b.model ? a.model < b.model : a.version < b.version; });
+
+        // the trees are encoded first to collect all strings
+        StringTable strings;
+        std::string trees;
+        std::vector<PackedEntry> packedEntries;
+        packedEntries.reserve(entries.size());
+        uint64_t infoTree = trees.size();
+        encodeMap(info, &strings, &trees);
+        for (auto &entry : entries)
+        {
+            PackedEntry packed;
+            packed.model = strings.add(entry.model);
+            packed.version = strings.add(entry.version);
+            packed.treeOffset = trees.size();
+            packed.stamp = pack(entry.stamp);
+            encodeMap(entry.content, &strings, &trees);
+            packedEntries.push_back(packed);
+        }
+
+        std::string out;
+        Header header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, magic, sizeof(magic));
+        header.version = formatVersion;
+        header.byteOrder = byteOrderMark;
+        header.stringCount = strings.get().size();
+        header.entryCount = packedEntries.size();
+        header.info = pack(state.info);
+        header.journal = pack(state.journal);
+        header.journalExists = state.journalExists;
+        header.journalValidSize = state.journalValidSize;
+        header.journalRecords = state.journalRecords;
+        put(&out, header);
+
+        header.stringTableOffset = out.size();
+        uint64_t position = 0;
+        for (const auto &s : strings.get())
+        {
+            put<uint64_t>(&out, position);
+            position += s.size();
+        }
+        put<uint64_t>(&out, position);
+        for (const auto &s : strings.get())
+        {
+            out += s;
+        }
+
+        header.entryTableOffset = out.size();
+        const uint64_t treesOffset = header.entryTableOffset + packedEntries.size() * sizeof(PackedEntry);
+        for (auto &packed : packedEntries)
+        {
+            packed.treeOffset += treesOffset;
+            put(&out, packed);
+        }
+        header.infoOffset = treesOffset + infoTree;
+        out += trees;
+        putAt(&out, 0, header);
+        return out;
+    }
+
+    bool FileDBSnapshot::open(const std::string &file)
+    {
+        close();
+        int fd = ::open(file.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Header))
+        {
+            ::close(fd);
+            return false;
+        }
+        void *mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED)
+        {
+            return false;
+        }
+        data = static_cast<const char *>(mapped);
+        dataSize = st.st_size;
+        fileStamp.device = st.st_dev;
+        fileStamp.inode = st.st_ino;
+        fileStamp.size = st.st_size;
+#ifdef __APPLE__
+        fileStamp.sec = st.st_mtimespec.tv_sec;
+        fileStamp.nsec = st.st_mtimespec.tv_nsec;
+#else
+        fileStamp.sec = st.st_mtim.tv_sec;
+        fileStamp.nsec = st.st_mtim.tv_nsec;
+#endif
+
+        Header header;
+        memcpy(&header, data, sizeof(header));
+        if (memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != formatVersion ||
+            header.byteOrder != byteOrderMark ||
+            header.stringTableOffset > dataSize ||
+            header.stringCount >= (dataSize - header.stringTableOffset) / sizeof(uint64_t) ||
+            header.entryTableOffset > dataSize ||
+            header.entryCount > (dataSize - header.entryTableOffset) / sizeof(PackedEntry) ||
+            header.infoOffset >= dataSize)
+        {
+            close();
+            return false;
+        }
+        stringCount = header.stringCount;
+        stringTableOffset = header.stringTableOffset;
+        entryCount = header.entryCount;
+        entryTableOffset = header.entryTableOffset;
+        infoOffset = header.infoOffset;
+        indexState.info = unpack(header.info);
+        indexState.journal = unpack(header.journal);
+        indexState.journalExists = header.journalExists != 0;
+        indexState.journalValidSize = header.journalValidSize;
+        indexState.journalRecords = header.journalRecords;
+        return true;
+    }
+
+    void FileDBSnapshot::close()
+    {
+        if (data)
+        {
+            munmap(const_cast<char *>(data), dataSize);
+        }
+        data = nullptr;
+        dataSize = 0;
+        fileStamp = Stamp();
+        indexState = IndexState();
+        stringCount = entryCount = 0;
+    }
+
+    bool FileDBSnapshot::getString(uint64_t id, std::string *s) const
+    {
+        if (id >= stringCount)
+        {
+            return false;
+        }
+        uint64_t range[2];
+        memcpy(range, data + stringTableOffset + id * sizeof(uint64_t), sizeof(range));
+        const uint64_t charsOffset = stringTableOffset + (stringCount + 1) * sizeof(uint64_t);
+        if (range[0] > range[1] || charsOffset + range[1] > dataSize)
+        {
+            return false;
+        }
+        s->assign(data + charsOffset + range[0], range[1] - range[0]);
+        return true;
+    }
+
+    int FileDBSnapshot::compareString(uint64_t id, const std::string &s) const
+    {
+        std::string value;
+        getString(id, &value);
+        return value.compare(s);
+    }
+
+    bool FileDBSnapshot::decodeItem(uint64_t *offset, ConfigItem *item, int depth) const
+    {
+        if (depth > maxDepth || *offset + sizeof(uint8_t) > dataSize)
+        {
+            return false;
+        }
+        uint8_t tag = data[*offset];
+        *offset += sizeof(uint8_t);
+        if (tag == TAG_EMPTY)
+        {
+            return true;
+        }
+        uint32_t value;
+        if (*offset + sizeof(value) > dataSize)
+        {
+            return false;
+        }
+        memcpy(&value, data + *offset, sizeof(value));
+        *offset += sizeof(value);
+        if (tag == TAG_ATOM)
+        {
+            std::string s;
+            if (!getString(value, &s))
+            {
+                return false;
+            }
+            *item = s;
+            return true;
+        }
+        if (tag == TAG_MAP)
+        {
+            ConfigMap map;
+            for (uint32_t i = 0; i < value; ++i)
+            {
+                uint32_t key;
+                std::string keyString;
+                if (*offset + sizeof(key) > dataSize)
+                {
+                    return false;
+                }
+                memcpy(&key, data + *offset, sizeof(key));
+                *offset += sizeof(key);
+                if (!getString(key, &keyString) || !decodeItem(offset, &map[keyString], depth + 1))
+                {
+                    return false;
+                }
+            }
+            *item = map;
+            return true;
+        }
+        if (tag == TAG_VECTOR)
+        {
+            ConfigVector vector;
+            for (uint32_t i = 0; i < value; ++i)
+            {
+                ConfigItem child;
+                if (!decodeItem(offset, &child, depth + 1))
+                {
+                    return false;
+                }
+                vector.push_back(child);
+            }
+            *item = vector;
+            return true;
+        }
+        return false;
+    }
+
+    bool FileDBSnapshot::decodeInfo(ConfigMap *info) const
+    {
+        if (!data)
+        {
+            return false;
+        }
+        uint64_t offset = infoOffset;
+        ConfigItem item;
+        if (!decodeItem(&offset, &item, 0) || !item.isMap())
+        {
+            return false;
+        }
+        ConfigMap &map = item;
+        *info = map;
+        return true;
+    }
+
+    bool FileDBSnapshot::findVersion(const std::string &model, const std::string &version,
+                                     ConfigMap *content, Stamp *stamp) const
+    {
+        if (!data)
+        {
+            return false;
+        }
+        // binary search in the sorted entry table
+        uint64_t low = 0, high = entryCount;
+        while (low < high)
+        {
+            uint64_t mid = low + (high - low) / 2;
+            PackedEntry entry;
+            memcpy(&entry, data + entryTableOffset + mid * sizeof(PackedEntry), sizeof(entry));
+            int c = compareString(entry.model, model);
+            if (c == 0)
+            {
+                c = compareString(entry.version, version);
+            }
+            if (c == 0)
+            {
+                uint64_t offset = entry.treeOffset;
+                ConfigItem item;
+                if (!decodeItem(&offset, &item, 0) || !item.isMap())
+                {
+                    return false;
+                }
+                ConfigMap &map = item;
+                *content = map;
+                *stamp = unpack(entry.stamp);
+                return true;
+            }
+            if (c < 0)
+            {
+                low = mid + 1;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+        return false;
+    }
+
+} // end of namespace xrock_gui_model
@@ -0,0 +1,100 @@
+/**
+ * \file FileDBSnapshot.hpp
+ * \brief Binary snapshot (.xpack) of a FileDB directory which is memory-mapped and decoded on demand
+ **/
+
+#pragma once
+#include <configmaps/ConfigMap.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace xrock_gui_model
+{
+
+    /**
+     * @brief Reader and writer of the packed FileDB snapshot format.
+     *
+     * A snapshot is one file with a string table, the index (info.yml plus the
+     * journal), a sorted model/version table and the raw content of every
+     * model.yml as a binary tree. The reader maps the file read-only and only
+     * decodes what is requested, so opening it does not parse anything.
+     * Every part records the stamp of the file it was built from; the caller
+     * compares these stamps to decide whether the snapshot is stale.
+     */
+    class FileDBSnapshot
+    {
+    public:
+        struct Stamp
+        {
+            uint64_t device = 0;
+            uint64_t inode = 0;
+            uint64_t size = 0;
+            int64_t sec = 0;
+            int64_t nsec = 0;
+
+            bool operator==(const Stamp &other) const;
+            bool operator!=(const Stamp &other) const { return !(*this == other); }
+        };
+
+        // State of the index files the snapshot was built from
+        struct IndexState
+        {
+            Stamp info;
+            bool journalExists = false;
+            Stamp journal;
+            uint64_t journalValidSize = 0;
+            uint64_t journalRecords = 0;
+        };
+
+        // Content of one model.yml as read from disk (legacy format)
+        struct Entry
+        {
+            std::string model;
+            std::string version;
+            Stamp stamp;
+            configmaps::ConfigMap content;
+        };
+
+        FileDBSnapshot();
+        ~FileDBSnapshot();
+        FileDBSnapshot(const FileDBSnapshot &) = delete;
+        FileDBSnapshot &operator=(const FileDBSnapshot &) = delete;
+
+        // Serializes a snapshot, the entries may be in any order
+        static std::string encode(configmaps::ConfigMap &info, const IndexState &state,
+                                  std::vector<Entry> &entries);
+
+        // Maps the file and checks its header. Returns false if it does not exist or is invalid.
+        bool open(const std::string &file);
+        void close();
+        bool isOpen() const { return data != nullptr; }
+        // Stamp of the snapshot file itself, to notice when it is rebuilt
+        const Stamp &getFileStamp() const { return fileStamp; }
+
+        const IndexState &getIndexState() const { return indexState; }
+        // Decodes the index as it was when the snapshot was built
+        bool decodeInfo(configmaps::ConfigMap *info) const;
+        // Decodes the raw model.yml content of a version. Thread-safe.
+        bool findVersion(const std::string &model, const std::string &version,
+                         configmaps::ConfigMap *content, Stamp *stamp) const;
+        size_t getNumVersions() const { return entryCount; }
+
+    private:
+        const char *data;
+        size_t dataSize;
+        Stamp fileStamp;
+        IndexState indexState;
+        uint64_t stringCount;
+        uint64_t stringTableOffset;
+        uint64_t entryCount;
+        uint64_t entryTableOffset;
+        uint64_t infoOffset;
+
+        bool getString(uint64_t id, std::string *s) const;
+        int compareString(uint64_t id, const std::string &s) const;
+        bool decodeItem(uint64_t *offset, configmaps::ConfigItem *item, int depth) const;
+    };
+
+} // end of namespace xrock_gui_model
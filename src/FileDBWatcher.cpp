@@ -0,0 +1,249 @@
+/**
+ * \file FileDBWatcher.cpp
+ * \brief Watches a FileDB directory for changes made by other processes
+ **/
+
+#include "FileDBWatcher.hpp"
+
+#include <mars/utils/misc.h>
+
+#include <cerrno>
+#include <iostream>
+#include <dirent.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
+namespace xrock_gui_model
+{
+
+    namespace
+    {
+#ifdef __linux__
+        const uint32_t watchMask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE |
+                                   IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+        // events arriving within this time are reported together
+        const int collectMilliseconds = 100;
+#endif
+
+        bool isIndexFile(const std::string &name)
+        {
+            return name.compare(0, 8, "info.yml") == 0 || name == "info.journal" || name == "snapshot.xpack" || name == "manifest.yml";
+        }
+
+        // temporary files of atomic writes and the trash are not interesting
+        bool isIgnored(const std::string &name)
+        {
+            return name.empty() || name[0] == '.' || name.find(".tmp") != std::string::npos;
+        }
+
+        std::vector<std::string> listDirectories(const std::string &path)
+        {
+            std::vector<std::string> result;
+            DIR *dir = opendir(path.c_str());
+            if (!dir)
+            {
+                return result;
+            }
+            while (struct dirent *entry = readdir(dir))
+            {
+                std::string name = entry->d_name;
+                if (!isIgnored(name) && mars::utils::pathExists(path + "/" + name + "/."))
+                {
+                    result.push_back(name);
+                }
+            }
+            closedir(dir);
+            return result;
+        }
+    }
+
+    FileDBWatcher::FileDBWatcher(const std::string &dbAddress, Callback callback) : dbAddress(dbAddress), callback(callback),
+                                                                                     active(false), failed(false), inotifyFd(-1)
+    {
+        stopPipe[0] = stopPipe[1] = -1;
+#ifdef __linux__
+        inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotifyFd < 0 || pipe(stopPipe) != 0)
+        {
+            std::cerr << "FileDBWatcher: inotify not available, changes of other processes are noticed on access" << std::endl;
+            return;
+        }
+        if (!addWatch("") || watches.empty())
+        {
+            return;
+        }
+        for (const auto &model : listDirectories(dbAddress))
+        {
+            addModelWatches(model);
+        }
+        if (failed)
+        {
+            // the files are checked on access instead
+            return;
+        }
+        active = true;
+        thread = std::thread([this]
+                             { run(); });
+#endif
+    }
+
+    FileDBWatcher::~FileDBWatcher()
+    {
+        if (thread.joinable())
+        {
+            char c = 0;
+            if (write(stopPipe[1], &c, 1) != 1)
+            {
+                std::cerr << "FileDBWatcher: could not stop thread" << std::endl;
+            }
+            thread.join();
+        }
+        for (int fd : {inotifyFd, stopPipe[0], stopPipe[1]})
+        {
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+        }
+    }
+
+    bool FileDBWatcher::addWatch(const std::string &relativePath)
+    {
+#ifdef __linux__
+        const std::string path = relativePath.empty() ? dbAddress : dbAddress + "/" + relativePath;
+        int wd = inotify_add_watch(inotifyFd, path.c_str(), watchMask);
+        if (wd < 0)
+        {
+            // the directory may have been removed meanwhile, which is no reason to give up
+            if (errno == ENOENT)
+            {
+                return true;
+            }
+            // e.g. fs.inotify.max_user_watches reached
+            if (!failed)
+            {
+                std::cerr << "FileDBWatcher: could not watch " << path << ", changes of other processes are noticed on access" << std::endl;
+            }
+            failed = true;
+            return false;
+        }
+        watches[wd] = relativePath;
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void FileDBWatcher::addModelWatches(const std::string &model)
+    {
+        addWatch(model);
+        for (const auto &version : listDirectories(dbAddress + "/" + model))
+        {
+            addWatch(model + "/" + version);
+        }
+    }
+
+    void FileDBWatcher::run()
+    {
+#ifdef __linux__
+        alignas(struct inotify_event) char buffer[16384];
+        bool indexChanged = false;
+        std::set<std::string> models;
+        while (true)
+        {
+            struct pollfd fds[2] = {{inotifyFd, POLLIN, 0}, {stopPipe[0], POLLIN, 0}};
+            const bool collecting = indexChanged || !models.empty();
+            int n = poll(fds, 2, collecting ? collectMilliseconds : -1);
+            if (n < 0)
+            {
+                continue;
+            }
+            if (fds[1].revents)
+            {
+                return;
+            }
+            if (n == 0)
+            {
+                // quiet for a moment, report what was collected
+                callback(indexChanged, models);
+                indexChanged = false;
+                models.clear();
+                continue;
+            }
+            ssize_t length;
+            while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0)
+            {
+                for (char *p = buffer; p < buffer + length;)
+                {
+                    const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(p);
+                    p += sizeof(struct inotify_event) + event->len;
+                    if (event->mask & IN_Q_OVERFLOW)
+                    {
+                        // events were lost, everything may have changed
+                        indexChanged = true;
+                        models.insert("");
+                        continue;
+                    }
+                    auto watch = watches.find(event->wd);
+                    if (watch == watches.end())
+                    {
+                        continue;
+                    }
+                    if (event->mask & IN_IGNORED)
+                    {
+                        watches.erase(watch);
+                        continue;
+                    }
+                    const std::string name = event->len ? event->name : "";
+                    const std::string &path = watch->second;
+                    const bool newDirectory = (event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO));
+                    if (path.empty())
+                    {
+                        if (isIndexFile(name))
+                        {
+                            indexChanged = true;
+                        }
+                        else if (!isIgnored(name) && (event->mask & IN_ISDIR))
+                        {
+                            if (newDirectory)
+                            {
+                                addModelWatches(name);
+                            }
+                            // in the sharded layout, model directories appearing or vanishing change the index
+                            indexChanged = true;
+                            models.insert(name);
+                        }
+                        continue;
+                    }
+                    if (isIgnored(name) && !name.empty())
+                    {
+                        continue;
+                    }
+                    const size_t slash = path.find('/');
+                    if (slash == std::string::npos && newDirectory)
+                    {
+                        addWatch(path + "/" + name);
+                    }
+                    if (slash == std::string::npos && name == "versions.yml")
+                    {
+                        // the shard of the model in the sharded layout
+                        indexChanged = true;
+                    }
+                    models.insert(path.substr(0, slash));
+                }
+            }
+            if (failed)
+            {
+                // a new directory could not be watched, the files have to be checked on access from now on
+                active = false;
+                callback(true, {""});
+                return;
+            }
+        }
+#endif
+    }
+
+} // end of namespace xrock_gui_model
@@ -0,0 +1,68 @@
+/**
+ * \file FileDBWatcher.hpp
+ * \brief Watches a FileDB directory for changes made by other processes
+ **/
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace xrock_gui_model
+{
+
+    /**
+     * @brief Reports changes inside a FileDB directory from a background thread.
+     *
+     * Watches the database directory (info.yml, the journal, the snapshot and
+     * the manifest of the sharded layout),
+     * every model directory and every version directory with inotify. Events
+     * are collected for a short moment and then reported once per model, so a
+     * write through a temporary file results in a single notification.
+     * On systems without inotify the watcher is never active.
+     *
+     * If a directory cannot be watched (e.g. fs.inotify.max_user_watches is
+     * reached), changes inside it would go unnoticed: the watcher becomes
+     * inactive for good and reports everything as changed once.
+     */
+    class FileDBWatcher
+    {
+    public:
+        // indexChanged: info.yml, the journal, the snapshot, the manifest, a shard or the set of model directories changed
+        // models: models whose directories or model files changed
+        typedef std::function<void(bool indexChanged, const std::set<std::string> &models)> Callback;
+
+        FileDBWatcher(const std::string &dbAddress, Callback callback);
+        ~FileDBWatcher();
+        FileDBWatcher(const FileDBWatcher &) = delete;
+        FileDBWatcher &operator=(const FileDBWatcher &) = delete;
+
+        // False if watching is not supported or a directory of the database could not be watched.
+        // May change to false at any time; the notifications cannot be relied on afterwards.
+        bool isActive() const { return active; }
+
+    private:
+        std::string dbAddress;
+        Callback callback;
+        std::atomic<bool> active;
+        // set by a failed watch, clears active once the thread runs
+        bool failed;
+        int inotifyFd;
+        int stopPipe[2];
+        std::thread thread;
+        // watch descriptor -> path relative to dbAddress ("" for the database directory)
+        std::map<int, std::string> watches;
+
+        // Returns false and sets failed if the directory could not be watched
+        bool addWatch(const std::string &relativePath);
+        void addModelWatches(const std::string &model);
+        void run();
+    };
+
+} // end of namespace xrock_gui_model
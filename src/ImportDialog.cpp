@@ -1,10 +1,15 @@
 #include "ImportDialog.hpp"
+#include "AsyncDB.hpp"
+#include "ModelSearchCache.hpp"
 #include <mars/config_map_gui/DataWidget.h>
 
 #include <QVBoxLayout>
 #include <QPushButton>
+#include <QMessageBox>
 #include <QDesktopServices>
+#include <algorithm>
 #include <array>
+#include <iterator>
 #include "utils/WaitCursorRAII.hpp"
 
 using namespace configmaps;
@@ -31,6 +36,8 @@ namespace xrock_gui_model
     std::string ImportDialog::lastFilter = "";
 
     ImportDialog::ImportDialog(XRockGUI *xrockGui, Intention intent) : xrockGui(xrockGui), intent(intent),
+                                                                ignoreUpdate(false),
+                                                                addWhenLoaded(false),
                                                                 selectedDomain(""),
                                                                 selectedModel(""),
                                                                 selectedVersion("")
@@ -52,10 +59,16 @@ namespace xrock_gui_model
             index++;
         }
 
+        // the domain of the last session may not exist in this database
+        if (!indexMap.hasKey(lastDomain) && !domains.empty())
+        {
+            lastDomain = domains.front();
+        }
+
         connect(domainSelect, SIGNAL(currentIndexChanged(const QString &)),
                 this, SLOT(changeDomain(const QString &)));
 
-        QLabel *label = new QLabel("name/type filter:");
+        QLabel *label = new QLabel("search name, type, interfaces, description:");
         vLayout->addWidget(label);
         filterPattern = new QLineEdit();
         filterPattern->setText(lastFilter.c_str());
@@ -120,6 +133,13 @@ namespace xrock_gui_model
         setLayout(mainLayout);
         doc->setHtml("");
         doc->setStyleSheet("background-color:#eeeeee;");
+
+        // search results are listed again once the index of the domain is built or changed
+        connect(this, SIGNAL(sigSearchIndexChanged(const QString &)),
+                this, SLOT(searchIndexChanged(const QString &)), Qt::QueuedConnection);
+        searchListenerId = xrockGui->getSearchCache().addListener([this](const std::string &domain)
+                                                                  { emit sigSearchIndexChanged(QString::fromStdString(domain)); });
+
         if ((int)indexMap[lastDomain] == 0)
         {
             changeDomain(lastDomain.c_str());
@@ -133,10 +153,19 @@ namespace xrock_gui_model
         {
             updateFilter(lastFilter.c_str());
         }
+
+        // keep the list up to date while other tools write into the database
+        connect(this, SIGNAL(sigModelChanged(const QString &, const QString &)),
+                this, SLOT(modelChanged(const QString &, const QString &)), Qt::QueuedConnection);
+        changeListenerId = xrockGui->db->addChangeListener([this](const std::string &domain, const std::string &model)
+                                                           { emit sigModelChanged(QString::fromStdString(domain), QString::fromStdString(model)); });
     }
 
     ImportDialog::~ImportDialog()
     {
+        xrockGui->getAsyncDB().cancel(this);
+        xrockGui->getSearchCache().removeListener(searchListenerId);
+        xrockGui->db->removeChangeListener(changeListenerId);
     }
 
     void ImportDialog::urlClicked(const QUrl &link)
@@ -146,46 +175,62 @@ namespace xrock_gui_model
 
     void ImportDialog::modelClicked(const QModelIndex &index)
     {
-        ignoreUpdate = true;
-        std::string firstVersion;
         QVariant v = models->model()->data(index, 0);
-        if (v.isValid())
+        if (!v.isValid())
         {
-            WaitCursorRAII _;
-            selectedModel = v.toString().toStdString();
-            selectedVersion = std::string("");
-            dw->clearGUI();
-            versionSelect->clear();
-            std::vector<std::string> versionList = xrockGui->db->requestVersions(selectedDomain, selectedModel);
-            for (std::vector<std::string>::iterator it = versionList.begin(); it != versionList.end(); ++it)
-            {
-                if (firstVersion.empty())
-                {
-                    firstVersion = (*it);
-                }
-                versionSelect->addItem((*it).c_str());
-            }
+            return;
         }
+        selectedModel = v.toString().toStdString();
+        selectedVersion = std::string("");
+        dw->clearGUI();
+        ignoreUpdate = true;
+        versionSelect->clear();
         ignoreUpdate = false;
-        if (!firstVersion.empty())
-        {
-            versionChanged(firstVersion.c_str());
-        }
+        // results of requests for the previously selected model are not of interest anymore
+        AsyncDB &asyncDB = xrockGui->getAsyncDB();
+        asyncDB.cancel(this);
+        pendingModel = std::shared_future<ConfigMap>();
+        addWhenLoaded = false;
+        asyncDB.requestVersions(selectedDomain, selectedModel, this, [this](const std::vector<std::string> &versionList)
+                                {
+            ignoreUpdate = true;
+            for (const auto &it : versionList)
+            {
+                versionSelect->addItem(it.c_str());
+            }
+            ignoreUpdate = false;
+            if (!versionList.empty())
+            {
+                versionChanged(versionList.front().c_str());
+            } });
     }
 
     void ImportDialog::versionChanged(const QString &versionName)
     {
-        if (ignoreUpdate)
+        if (ignoreUpdate || versionName.isEmpty())
             return;
         selectedVersion = versionName.toStdString();
         dw->clearGUI();
-        ConfigMap map;
-        {
-                WaitCursorRAII _;
-                map = xrockGui->db->requestModel(selectedDomain, selectedModel, selectedVersion, true);
-        }
-        if(intent == Intention::ADD_TYPE){ model = map;}
         doc->setHtml("");
+        // only the last selected version is shown
+        AsyncDB &asyncDB = xrockGui->getAsyncDB();
+        asyncDB.cancel(this);
+        addWhenLoaded = false;
+        pendingModel = asyncDB.requestModel(selectedDomain, selectedModel, selectedVersion, true, this,
+                                            [this](const ConfigMap &result)
+                                            {
+            showModel(result);
+            if (addWhenLoaded)
+            {
+                addWhenLoaded = false;
+                model = result;
+                done(0);
+            } });
+    }
+
+    void ImportDialog::showModel(const ConfigMap &result)
+    {
+        ConfigMap map = result;
         if (map["versions"][0].hasKey("data"))
         {
             {
@@ -226,6 +271,29 @@ namespace xrock_gui_model
                 xrockGui->addComponent(selectedDomain, selectedModel, selectedVersion);
                 break;
             }
+            case Intention::ADD_TYPE:
+            {
+                // the caller needs the model as soon as the dialog is done; if it is still on its way
+                // behind other requests, the dialog is done once it arrives instead of waiting here
+                if (pendingModel.valid())
+                {
+                    if (pendingModel.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                    {
+                        addWhenLoaded = true;
+                        return;
+                    }
+                    try
+                    {
+                        model = pendingModel.get();
+                    }
+                    catch (const std::exception &e)
+                    {
+                        QMessageBox::critical(this, "Error", QString::fromStdString(e.what()), QMessageBox::Ok);
+                        return;
+                    }
+                }
+                break;
+            }
             default:
                 break;
             }
@@ -233,11 +301,35 @@ namespace xrock_gui_model
         }
     }
 
-    void ImportDialog::updateFilter(const QString &filter)
+    bool ImportDialog::matchesFilter(const std::pair<std::string, std::string> &entry) const
     {
-        QRegExp exp(filter, Qt::CaseInsensitive);
+        QRegExp exp(filterPattern->text(), Qt::CaseInsensitive);
+        return (exp.indexIn(entry.first.c_str()) != -1 ||
+                exp.indexIn(entry.second.c_str()) != -1);
+    }
 
+    void ImportDialog::updateFilter(const QString &filter)
+    {
+        lastFilter = filter.toStdString();
         models->clear();
+        std::vector<ModelSearchIndex::Result> results;
+        if (!filter.trimmed().isEmpty() && xrockGui->getSearchCache().search(lastFilter, selectedDomain, &results))
+        {
+            // best match first
+            for (const auto &result : results)
+            {
+                models->addItem(result.name.c_str());
+            }
+            // the list is also refreshed when an indexed model changes
+            QList<QListWidgetItem *> selected = models->findItems(QString::fromStdString(selectedModel), Qt::MatchExactly);
+            if (!selectedModel.empty() && !selected.isEmpty())
+            {
+                models->setCurrentItem(selected.front());
+            }
+            return;
+        }
+
+        QRegExp exp(filter, Qt::CaseInsensitive);
         for (auto it : modelList)
         {
             if (exp.indexIn(it.first.c_str()) != -1 ||
@@ -246,7 +338,87 @@ namespace xrock_gui_model
                 models->addItem(it.first.c_str());
             }
         }
-        lastFilter = filter.toStdString();
+    }
+
+    void ImportDialog::searchIndexChanged(const QString &domain)
+    {
+        if (domain.toStdString() == selectedDomain && !filterPattern->text().trimmed().isEmpty())
+        {
+            updateFilter(filterPattern->text());
+        }
+    }
+
+    void ImportDialog::modelChanged(const QString &domain, const QString &model)
+    {
+        if (!domain.isEmpty() && domain.toStdString() != selectedDomain)
+            return;
+        // the index of the database is cached, so requesting the list is cheap
+        std::vector<std::pair<std::string, std::string>> newList = xrockGui->db->requestModelListByDomain(selectedDomain);
+        std::sort(newList.begin(), newList.end());
+        newList.erase(std::unique(newList.begin(), newList.end()), newList.end());
+
+        // only touch the items which differ, so selection and scroll position are kept
+        std::vector<std::pair<std::string, std::string>> removed, added;
+        std::set_difference(modelList.begin(), modelList.end(), newList.begin(), newList.end(), std::back_inserter(removed));
+        std::set_difference(newList.begin(), newList.end(), modelList.begin(), modelList.end(), std::back_inserter(added));
+        modelList = newList;
+        // search results are listed again once the index has the change
+        if (!xrockGui->getSearchCache().isReady(selectedDomain) || filterPattern->text().trimmed().isEmpty())
+        {
+            for (const auto &it : removed)
+            {
+                for (QListWidgetItem *item : models->findItems(QString::fromStdString(it.first), Qt::MatchExactly))
+                {
+                    delete models->takeItem(models->row(item));
+                }
+            }
+            for (const auto &it : added)
+            {
+                if (matchesFilter(it) && models->findItems(QString::fromStdString(it.first), Qt::MatchExactly).isEmpty())
+                {
+                    models->addItem(it.first.c_str());
+                }
+            }
+            if (!added.empty())
+            {
+                models->sortItems();
+            }
+        }
+
+        if (!selectedModel.empty() && (model.isEmpty() || model.toStdString() == selectedModel))
+        {
+            updateVersions();
+        }
+    }
+
+    void ImportDialog::updateVersions()
+    {
+        std::vector<std::string> versionList = xrockGui->db->requestVersions(selectedDomain, selectedModel);
+        if (versionList.empty())
+        {
+            // the selected model was removed
+            selectedModel = std::string("");
+            selectedVersion = std::string("");
+            versionSelect->clear();
+            dw->clearGUI();
+            doc->setHtml("");
+            return;
+        }
+        const std::string previousVersion = selectedVersion;
+        ignoreUpdate = true;
+        versionSelect->clear();
+        for (const auto &it : versionList)
+        {
+            versionSelect->addItem(it.c_str());
+        }
+        ignoreUpdate = false;
+        int index = versionSelect->findText(QString::fromStdString(previousVersion));
+        if (index >= 0)
+        {
+            versionSelect->setCurrentIndex(index);
+        }
+        // reload the shown version, its content may have changed as well
+        versionChanged(versionSelect->itemText(index >= 0 ? index : 0));
     }
 
     void ImportDialog::changeDomain(const QString &domain)
@@ -269,6 +441,8 @@ namespace xrock_gui_model
         }
         models->sortItems();
         lastDomain = selectedDomain;
+        // the index is kept between the dialogs, only built on the first use of the domain
+        xrockGui->getSearchCache().prepare(selectedDomain);
     }
 
 } // end of namespace xrock_gui_model
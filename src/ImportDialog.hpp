@@ -13,6 +13,7 @@
 #include <QComboBox>
 #include <QLabel>
 #include <QWebView>
+#include <future>
 
 namespace mars
 {
@@ -52,8 +53,14 @@ namespace xrock_gui_model
         void updateFilter(const QString &filter);
         void changeDomain(const QString &domain);
         void urlClicked(const QUrl &);
+        void modelChanged(const QString &domain, const QString &model);
+        void searchIndexChanged(const QString &domain);
 
     signals:
+        // emitted from the thread of the database when a model changed
+        void sigModelChanged(const QString &domain, const QString &model);
+        // emitted from the thread of the search cache when the index of a domain was built or changed
+        void sigSearchIndexChanged(const QString &domain);
         void sigLoadComponent(std::string domain, std::string model, std::string version);
         void sigAddComponent(std::string domain, std::string model, std::string version);
 
@@ -61,12 +68,18 @@ namespace xrock_gui_model
         XRockGUI *xrockGui;
         Intention intent;
         bool ignoreUpdate;
+        int changeListenerId;
+        int searchListenerId;
+        // "add type" was clicked before the selected version arrived, the dialog is done once it does
+        bool addWhenLoaded;
         std::string selectedDomain;
         std::string selectedModel;
         std::string selectedVersion;
         std::vector<std::pair<std::string, std::string>> modelList;
         configmaps::ConfigMap indexMap;
         configmaps::ConfigMap model;
+        // request of the selected version, running in the background
+        std::shared_future<configmaps::ConfigMap> pendingModel;
 
         QListWidget *models;
         QLineEdit *filterPattern;
@@ -75,6 +88,11 @@ namespace xrock_gui_model
         QLabel *versionLabel;
         QWebView *doc;
         mars::config_map_gui::DataWidget *dw;
+
+        bool matchesFilter(const std::pair<std::string, std::string> &entry) const;
+        void updateVersions();
+        // Fills the documentation and the data widget with the requested model
+        void showModel(const configmaps::ConfigMap &result);
     };
 } // end of namespace xrock_gui_model
 
@@ -0,0 +1,134 @@
+/**
+ * \file LazyModel.cpp
+ * \brief Version list of a component model whose version bodies are only loaded on access
+ **/
+
+#include "LazyModel.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace configmaps;
+
+namespace xrock_gui_model
+{
+
+    LazyModel::LazyModel() : state(std::make_shared<State>())
+    {
+    }
+
+    LazyModel::LazyModel(const std::vector<std::string> &versions, Loader loader, BulkLoader bulkLoader) : state(std::make_shared<State>())
+    {
+        state->versions = versions;
+        state->bodies.resize(versions.size());
+        state->loaded.resize(versions.size(), false);
+        state->loader = loader;
+        state->bulkLoader = bulkLoader;
+    }
+
+    bool LazyModel::empty() const
+    {
+        return state->versions.empty();
+    }
+
+    size_t LazyModel::size() const
+    {
+        return state->versions.size();
+    }
+
+    const std::vector<std::string> &LazyModel::getVersionNames() const
+    {
+        return state->versions;
+    }
+
+    int LazyModel::findVersion(const std::string &version) const
+    {
+        auto it = std::find(state->versions.begin(), state->versions.end(), version);
+        if (it == state->versions.end())
+        {
+            return -1;
+        }
+        return it - state->versions.begin();
+    }
+
+    bool LazyModel::isLoaded(size_t index) const
+    {
+        return index < state->loaded.size() && state->loaded[index];
+    }
+
+    const ConfigMap &LazyModel::getVersion(size_t index) const
+    {
+        if (index >= state->versions.size())
+        {
+            throw std::out_of_range("LazyModel: no version with index " + std::to_string(index));
+        }
+        if (!state->loaded[index])
+        {
+            state->bodies[index] = state->loader(state->versions[index]);
+            state->loaded[index] = true;
+        }
+        return state->bodies[index];
+    }
+
+    void LazyModel::loadAll() const
+    {
+        std::vector<size_t> missing;
+        for (size_t i = 0; i < size(); ++i)
+        {
+            if (!state->loaded[i])
+            {
+                missing.push_back(i);
+            }
+        }
+        if (missing.size() < 2 || !state->bulkLoader)
+        {
+            for (size_t i : missing)
+            {
+                getVersion(i);
+            }
+            return;
+        }
+        std::vector<std::string> names;
+        names.reserve(missing.size());
+        for (size_t i : missing)
+        {
+            names.push_back(state->versions[i]);
+        }
+        std::vector<ConfigMap> bodies = state->bulkLoader(names);
+        for (size_t k = 0; k < missing.size() && k < bodies.size(); ++k)
+        {
+            state->bodies[missing[k]] = bodies[k];
+            state->loaded[missing[k]] = true;
+        }
+    }
+
+    ConfigMap LazyModel::toConfigMap() const
+    {
+        if (state->bulkLoader)
+        {
+            loadAll();
+        }
+        ConfigMap result;
+        for (size_t i = 0; i < size(); ++i)
+        {
+            ConfigMap map = getVersion(i);
+            if (map.empty())
+            {
+                break;
+            }
+            if (result.empty())
+            {
+                result = map;
+                continue;
+            }
+            result["versions"].push_back(map["versions"][0]);
+            // keep the copy of the original model info in sync
+            if (result.hasKey("model") && map.hasKey("model"))
+            {
+                result["model"]["versions"].push_back(map["model"]["versions"][0]);
+            }
+        }
+        return result;
+    }
+
+} // end of namespace xrock_gui_model
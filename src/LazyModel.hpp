@@ -0,0 +1,85 @@
+/**
+ * \file LazyModel.hpp
+ * \brief Version list of a component model whose version bodies are only loaded on access
+ **/
+
+#pragma once
+#include <configmaps/ConfigMap.hpp>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace xrock_gui_model
+{
+
+    /**
+     * @brief Lightweight multi-version result of a database request.
+     *
+     * Only the names of the versions are known up front. The complete model
+     * of a version is requested from the loader the first time it is accessed
+     * and kept afterwards. Copies of a LazyModel share the loaded versions.
+     * The loader usually references the backend which created the LazyModel,
+     * so the LazyModel must not outlive that backend.
+     */
+    class LazyModel
+    {
+    public:
+        // Returns the model containing only the given version, or an empty map if it could not be loaded
+        typedef std::function<configmaps::ConfigMap(const std::string &version)> Loader;
+        // Optional: loads several versions at once (e.g. in parallel), results in the given order
+        typedef std::function<std::vector<configmaps::ConfigMap>(const std::vector<std::string> &versions)> BulkLoader;
+
+        LazyModel();
+        LazyModel(const std::vector<std::string> &versions, Loader loader, BulkLoader bulkLoader = BulkLoader());
+
+        bool empty() const;
+        size_t size() const;
+        const std::vector<std::string> &getVersionNames() const;
+
+        /**
+         * @brief Returns the index of the given version or -1 if the model has no such version.
+         */
+        int findVersion(const std::string &version) const;
+
+        /**
+         * @brief Returns true if the version at the given index has already been loaded.
+         */
+        bool isLoaded(size_t index) const;
+
+        /**
+         * @brief Returns the model containing only the version at the given index.
+         *
+         * The map has the same format as requestModel(domain, model, version, true) returns.
+         * It is loaded on the first access.
+         */
+        const configmaps::ConfigMap &getVersion(size_t index) const;
+
+        /**
+         * @brief Loads all versions which are not loaded yet, with one call of the bulk loader if available.
+         */
+        void loadAll() const;
+
+        /**
+         * @brief Loads all versions and merges them into one map.
+         *
+         * The result has the format of requestModel(domain, model, "", false): the model
+         * of the first version with the versions of all further models appended. Like
+         * before, merging stops at the first version which could not be loaded.
+         */
+        configmaps::ConfigMap toConfigMap() const;
+
+    private:
+        struct State
+        {
+            std::vector<std::string> versions;
+            std::vector<configmaps::ConfigMap> bodies;
+            std::vector<bool> loaded;
+            Loader loader;
+            BulkLoader bulkLoader;
+        };
+        std::shared_ptr<State> state;
+    };
+
+} // end of namespace xrock_gui_model
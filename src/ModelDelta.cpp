@@ -0,0 +1,267 @@
+/**
+ * \file ModelDelta.cpp
+ * \brief Structural difference between two versions of a model
+ **/
+
+#include "ModelDelta.hpp"
+
+using namespace configmaps;
+
+namespace xrock_gui_model
+{
+
+    namespace
+    {
+        bool equal(ConfigItem &a, ConfigItem &b);
+
+        bool equalMaps(ConfigMap &a, ConfigMap &b)
+        {
+            if (a.size() != b.size())
+            {
+                return false;
+            }
+            for (auto &it : a)
+            {
+                if (!b.hasKey(it.first) || !equal(it.second, b[it.first]))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool equal(ConfigItem &a, ConfigItem &b)
+        {
+            if (a.isMap() && b.isMap())
+            {
+                return equalMaps(a, b);
+            }
+            if (a.isVector() && b.isVector())
+            {
+                ConfigVector &va = a, &vb = b;
+                if (va.size() != vb.size())
+                {
+                    return false;
+                }
+                for (size_t i = 0; i < va.size(); ++i)
+                {
+                    if (!equal(va[i], vb[i]))
+                    {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            if (a.isAtom() && b.isAtom())
+            {
+                return a.toString() == b.toString();
+            }
+            return !a.isMap() && !a.isVector() && !a.isAtom() && !b.isMap() && !b.isVector() && !b.isAtom();
+        }
+
+        bool diffItem(ConfigItem &from, ConfigItem &to, ConfigMap *node);
+
+        bool diffMap(ConfigMap &from, ConfigMap &to, ConfigMap *node)
+        {
+            bool changed = false;
+            for (auto &it : from)
+            {
+                if (!to.hasKey(it.first))
+                {
+                    (*node)["del"].push_back(ConfigItem(it.first));
+                    changed = true;
+                }
+            }
+            for (auto &it : to)
+            {
+                if (!from.hasKey(it.first))
+                {
+                    (*node)["set"][it.first] = it.second;
+                    changed = true;
+                    continue;
+                }
+                ConfigMap sub;
+                if (diffItem(from[it.first], it.second, &sub))
+                {
+                    (*node)["sub"][it.first] = sub;
+                    changed = true;
+                }
+            }
+            return changed;
+        }
+
+        bool diffVector(ConfigVector &from, ConfigVector &to, ConfigMap *node)
+        {
+            size_t prefix = 0;
+            while (prefix < from.size() && prefix < to.size() && equal(from[prefix], to[prefix]))
+            {
+                ++prefix;
+            }
+            if (prefix == from.size() && prefix == to.size())
+            {
+                return false;
+            }
+            size_t suffix = 0;
+            while (suffix < from.size() - prefix && suffix < to.size() - prefix &&
+                   equal(from[from.size() - 1 - suffix], to[to.size() - 1 - suffix]))
+            {
+                ++suffix;
+            }
+            const size_t removed = from.size() - prefix - suffix;
+            const size_t inserted = to.size() - prefix - suffix;
+            if (removed == inserted)
+            {
+                // changed elements in place, e.g. a moved node
+                for (size_t i = prefix; i < prefix + removed; ++i)
+                {
+                    ConfigMap sub;
+                    if (diffItem(from[i], to[i], &sub))
+                    {
+                        (*node)["sub"][std::to_string(i)] = sub;
+                    }
+                }
+                return true;
+            }
+            (*node)["at"] = (int)prefix;
+            (*node)["remove"] = (int)removed;
+            for (size_t i = prefix; i < prefix + inserted; ++i)
+            {
+                (*node)["insert"].push_back(to[i]);
+            }
+            return true;
+        }
+
+        bool diffItem(ConfigItem &from, ConfigItem &to, ConfigMap *node)
+        {
+            if (from.isMap() && to.isMap())
+            {
+                ConfigMap sub;
+                if (!diffMap(from, to, &sub))
+                {
+                    return false;
+                }
+                (*node)["map"] = sub;
+                return true;
+            }
+            if (from.isVector() && to.isVector())
+            {
+                ConfigMap sub;
+                if (!diffVector(from, to, &sub))
+                {
+                    return false;
+                }
+                (*node)["vector"] = sub;
+                return true;
+            }
+            if (equal(from, to))
+            {
+                return false;
+            }
+            (*node)["value"] = to;
+            return true;
+        }
+
+        bool applyItem(ConfigItem &item, ConfigMap &node);
+
+        bool applyMap(ConfigMap &map, ConfigMap &node)
+        {
+            if (node.hasKey("del"))
+            {
+                for (auto &it : node["del"])
+                {
+                    map.erase(it.getString());
+                }
+            }
+            if (node.hasKey("set"))
+            {
+                ConfigMap &set = node["set"];
+                for (auto &it : set)
+                {
+                    map[it.first] = it.second;
+                }
+            }
+            if (node.hasKey("sub"))
+            {
+                ConfigMap &sub = node["sub"];
+                for (auto &it : sub)
+                {
+                    if (!map.hasKey(it.first) || !applyItem(map[it.first], it.second))
+                    {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        bool applyVector(ConfigVector &vector, ConfigMap &node)
+        {
+            if (node.hasKey("sub"))
+            {
+                ConfigMap &sub = node["sub"];
+                for (auto &it : sub)
+                {
+                    const size_t i = std::stoul(it.first);
+                    if (i >= vector.size() || !applyItem(vector[i], it.second))
+                    {
+                        return false;
+                    }
+                }
+            }
+            if (node.hasKey("at"))
+            {
+                const size_t at = (int)node["at"];
+                const size_t removed = node.hasKey("remove") ? (int)node["remove"] : 0;
+                if (at + removed > vector.size())
+                {
+                    return false;
+                }
+                vector.erase(vector.begin() + at, vector.begin() + at + removed);
+                if (node.hasKey("insert"))
+                {
+                    ConfigVector &inserted = node["insert"];
+                    vector.insert(vector.begin() + at, inserted.begin(), inserted.end());
+                }
+            }
+            return true;
+        }
+
+        bool applyItem(ConfigItem &item, ConfigMap &node)
+        {
+            if (node.hasKey("value"))
+            {
+                item = node["value"];
+                return true;
+            }
+            if (node.hasKey("map"))
+            {
+                return item.isMap() && applyMap(item, node["map"]);
+            }
+            if (node.hasKey("vector"))
+            {
+                return item.isVector() && applyVector(item, node["vector"]);
+            }
+            return false;
+        }
+    }
+
+    ConfigMap ModelDelta::diff(ConfigMap from, ConfigMap to)
+    {
+        ConfigMap node, sub;
+        if (diffMap(from, to, &sub))
+        {
+            node["map"] = sub;
+        }
+        return node;
+    }
+
+    bool ModelDelta::apply(ConfigMap &map, ConfigMap delta)
+    {
+        if (delta.empty())
+        {
+            return true;
+        }
+        return delta.hasKey("map") && applyMap(map, delta["map"]);
+    }
+
+} // end of namespace xrock_gui_model
@@ -0,0 +1,32 @@
+/**
+ * \file ModelDelta.hpp
+ * \brief Structural difference between two versions of a model
+ **/
+
+#pragma once
+#include <configmaps/ConfigData.h>
+
+namespace xrock_gui_model
+{
+
+    /**
+     * @brief Computes and applies the difference between two ConfigMaps.
+     *
+     * A difference node has one of the keys
+     *  - value: the item is replaced by the value
+     *  - map: {del: [keys], set: {key: value}, sub: {key: node}}
+     *  - vector: {sub: {index: node}} for changed elements, or
+     *    {at: index, remove: count, insert: [items]} if elements were added or removed
+     * Vectors keep their common begin and end, so moving one node of a large
+     * model results in a difference of the size of that node.
+     */
+    class ModelDelta
+    {
+    public:
+        // Returns the node which turns from into to; it is empty if both are equal
+        static configmaps::ConfigMap diff(configmaps::ConfigMap from, configmaps::ConfigMap to);
+        // Applies a node created by diff() to map. Returns false if it does not fit.
+        static bool apply(configmaps::ConfigMap &map, configmaps::ConfigMap delta);
+    };
+
+} // end of namespace xrock_gui_model
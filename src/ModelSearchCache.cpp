@@ -0,0 +1,226 @@
+/**
+ * \file ModelSearchCache.cpp
+ * \brief Search indices of the domains of a database, kept up to date in the background
+ **/
+
+#include "ModelSearchCache.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <tuple>
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace configmaps;
+
+namespace xrock_gui_model
+{
+
+    ModelSearchCache::ModelSearchCache(std::shared_ptr<DBInterface> db) : db(db), changeListenerId(-1), stopping(false),
+                                                                          nextListenerId(0), pool(new ThreadPool(1))
+    {
+#ifdef __linux__
+        // the indices are a convenience, the requests of the GUI go first
+        pool->submit([]
+                     { setpriority(PRIO_PROCESS, syscall(SYS_gettid), 10); });
+#endif
+        if (db)
+        {
+            changeListenerId = db->addChangeListener([this](const std::string &domain, const std::string &model)
+                                                     {
+                if (!stopping)
+                {
+                    pool->submit([this, domain, model]
+                                 { update(domain, model); });
+                } });
+        }
+    }
+
+    ModelSearchCache::~ModelSearchCache()
+    {
+        if (db && changeListenerId >= 0)
+        {
+            db->removeChangeListener(changeListenerId);
+        }
+        stopping = true;
+        pool.reset();
+    }
+
+    void ModelSearchCache::prepare(const std::string &domain)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!db || domains.count(domain))
+            {
+                return;
+            }
+            domains[domain];
+        }
+        pool->submit([this, domain]
+                     { build(domain); });
+    }
+
+    bool ModelSearchCache::isReady(const std::string &domain)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = domains.find(domain);
+        return it != domains.end() && it->second.ready;
+    }
+
+    bool ModelSearchCache::search(const std::string &query, const std::string &domain, std::vector<ModelSearchIndex::Result> *results)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = domains.find(domain);
+        if (it == domains.end() || !it->second.ready)
+        {
+            return false;
+        }
+        *results = it->second.index.search(query, domain);
+        return true;
+    }
+
+    int ModelSearchCache::addListener(Listener listener)
+    {
+        std::lock_guard<std::mutex> lock(listenerMutex);
+        listeners[nextListenerId] = listener;
+        return nextListenerId++;
+    }
+
+    void ModelSearchCache::removeListener(int id)
+    {
+        // a listener is not called anymore once this returns
+        std::lock_guard<std::mutex> lock(listenerMutex);
+        listeners.erase(id);
+    }
+
+    void ModelSearchCache::notify(const std::string &domain)
+    {
+        std::lock_guard<std::mutex> lock(listenerMutex);
+        for (const auto &it : listeners)
+        {
+            it.second(domain);
+        }
+    }
+
+    void ModelSearchCache::build(const std::string &domain)
+    {
+        if (stopping)
+        {
+            return;
+        }
+        ModelSearchIndex index;
+        try
+        {
+            std::vector<std::tuple<std::string, std::string, std::string>> requests;
+            for (const auto &entry : db->requestModelListByDomain(domain))
+            {
+                std::vector<std::string> versions = db->requestVersions(domain, entry.first);
+                if (!versions.empty())
+                {
+                    requests.emplace_back(domain, entry.first, versions.back());
+                }
+            }
+            for (size_t begin = 0; begin < requests.size() && !stopping; begin += batchSize)
+            {
+                const size_t end = std::min(begin + batchSize, requests.size());
+                std::vector<std::tuple<std::string, std::string, std::string>> batch(requests.begin() + begin, requests.begin() + end);
+                std::vector<ConfigMap> maps = db->requestModels(batch);
+                for (size_t i = 0; i < batch.size() && i < maps.size(); ++i)
+                {
+                    if (!maps[i].empty())
+                    {
+                        index.update(domain, std::get<1>(batch[i]), maps[i]);
+                    }
+                }
+            }
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "ModelSearchCache: could not index domain " << domain << ": " << e.what() << std::endl;
+            // the next prepare() tries again, until then the dialogs filter by name and type
+            std::lock_guard<std::mutex> lock(mutex);
+            domains.erase(domain);
+            return;
+        }
+        if (stopping)
+        {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            Domain &entry = domains[domain];
+            entry.index = std::move(index);
+            entry.ready = true;
+        }
+        notify(domain);
+    }
+
+    void ModelSearchCache::update(const std::string &domain, const std::string &model)
+    {
+        if (stopping)
+        {
+            return;
+        }
+        std::vector<std::string> indexed;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const auto &it : domains)
+            {
+                // change notifications do not always tell the domain
+                if (domain.empty() || it.first == domain)
+                {
+                    indexed.push_back(it.first);
+                }
+            }
+        }
+        for (const auto &name : indexed)
+        {
+            if (model.empty())
+            {
+                // anything may have changed
+                build(name);
+                continue;
+            }
+            ConfigMap map;
+            try
+            {
+                const auto list = db->requestModelListByDomain(name);
+                const bool listed = std::any_of(list.begin(), list.end(), [&model](const std::pair<std::string, std::string> &entry)
+                                                { return entry.first == model; });
+                if (listed)
+                {
+                    std::vector<std::string> versions = db->requestVersions(name, model);
+                    if (!versions.empty())
+                    {
+                        map = db->requestModel(name, model, versions.back(), true);
+                    }
+                }
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "ModelSearchCache: could not index " << model << ": " << e.what() << std::endl;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                auto it = domains.find(name);
+                if (it == domains.end())
+                {
+                    continue;
+                }
+                if (map.empty())
+                {
+                    it->second.index.remove(name, model);
+                }
+                else
+                {
+                    it->second.index.update(name, model, map);
+                }
+            }
+            notify(name);
+        }
+    }
+
+} // end of namespace xrock_gui_model
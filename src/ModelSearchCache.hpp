@@ -0,0 +1,83 @@
+/**
+ * \file ModelSearchCache.hpp
+ * \brief Search indices of the domains of a database, kept up to date in the background
+ **/
+
+#pragma once
+#include "DBInterface.hpp"
+#include "ModelSearchIndex.hpp"
+#include "utils/ThreadPool.hpp"
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace xrock_gui_model
+{
+
+    /**
+     * @brief One ModelSearchIndex per domain of a database, shared by all import dialogs.
+     *
+     * The index of a domain is built once on first use and then updated model by
+     * model through the change notifications of the database, so opening a dialog
+     * or switching the domain does not load all models again. Building and
+     * updating run on a thread of its own with a lowered priority and request the
+     * models in small batches, so the requests of the GUI and the AsyncDB worker
+     * are not held up behind them.
+     */
+    class ModelSearchCache
+    {
+    public:
+        // Called from the thread of the cache once the index of the domain was built or changed
+        typedef std::function<void(const std::string &domain)> Listener;
+
+        explicit ModelSearchCache(std::shared_ptr<DBInterface> db);
+        // Waits for the running task, the pending ones are skipped
+        ~ModelSearchCache();
+        ModelSearchCache(const ModelSearchCache &) = delete;
+        ModelSearchCache &operator=(const ModelSearchCache &) = delete;
+
+        const std::shared_ptr<DBInterface> &getDB() const { return db; }
+        // Starts building the index of the domain unless it was requested before
+        void prepare(const std::string &domain);
+        // True if the index of the domain is complete
+        bool isReady(const std::string &domain);
+        // Fills results like ModelSearchIndex::search(); returns false while the index is not ready
+        bool search(const std::string &query, const std::string &domain, std::vector<ModelSearchIndex::Result> *results);
+
+        int addListener(Listener listener);
+        void removeListener(int id);
+
+    private:
+        struct Domain
+        {
+            ModelSearchIndex index;
+            bool ready = false;
+        };
+
+        // number of models requested at once, the backend is free for other callers in between
+        static const size_t batchSize = 32;
+
+        std::shared_ptr<DBInterface> db;
+        int changeListenerId;
+        std::atomic<bool> stopping;
+        std::mutex mutex;
+        std::map<std::string, Domain> domains;
+        std::map<int, Listener> listeners;
+        int nextListenerId;
+        // held while the listeners are called
+        std::mutex listenerMutex;
+        // a single thread, so the build and the updates of the indices are applied in order
+        std::unique_ptr<ThreadPool> pool;
+
+        void build(const std::string &domain);
+        // Indexes the newest version of the model again in every domain listing it, an empty model rebuilds everything
+        void update(const std::string &domain, const std::string &model);
+        void notify(const std::string &domain);
+    };
+
+} // end of namespace xrock_gui_model
@@ -0,0 +1,377 @@
+/**
+ * \file ModelSearchIndex.cpp
+ * \brief Ranked full-text and fuzzy search over the models of any database backend
+ **/
+
+#include "ModelSearchIndex.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+
+using namespace configmaps;
+
+namespace xrock_gui_model
+{
+
+    namespace
+    {
+        // a word in the name counts more than the same word in the description
+        const float nameWeight = 8.0f;
+        const float typeWeight = 4.0f;
+        const float interfaceTypeWeight = 2.0f;
+        const float interfaceNameWeight = 1.0f;
+        const float descriptionWeight = 1.0f;
+
+        // quality of a match of a query word
+        const float exactMatch = 1.0f;
+        const float prefixMatch = 0.8f;
+        const float substringMatch = 0.6f;
+        // multiplied with the dice coefficient of the trigrams, which has to reach minSimilarity
+        const float fuzzyMatch = 0.5f;
+        const float minSimilarity = 0.5f;
+        // shorter words have too few trigrams to be compared fuzzily
+        const size_t minFuzzyLength = 4;
+
+        // bytes of multibyte characters are kept within words
+        bool isWordChar(char c)
+        {
+            return std::isalnum(static_cast<unsigned char>(c)) || static_cast<unsigned char>(c) >= 0x80;
+        }
+
+        std::string toLower(const std::string &text)
+        {
+            std::string result = text;
+            std::transform(result.begin(), result.end(), result.begin(), [](unsigned char c)
+                           { return std::tolower(c); });
+            return result;
+        }
+
+        std::vector<std::string> getTrigrams(const std::string &word)
+        {
+            std::vector<std::string> result;
+            for (size_t i = 0; i + 3 <= word.size(); ++i)
+            {
+                result.push_back(word.substr(i, 3));
+            }
+            std::sort(result.begin(), result.end());
+            result.erase(std::unique(result.begin(), result.end()), result.end());
+            return result;
+        }
+    }
+
+    uint32_t ModelSearchIndex::getWordId(const std::string &word)
+    {
+        auto it = vocabulary.find(word);
+        if (it != vocabulary.end())
+        {
+            return it->second;
+        }
+        const uint32_t id = words.size();
+        vocabulary.emplace(word, id);
+        words.push_back(word);
+        postings.emplace_back();
+        for (const auto &trigram : getTrigrams(word))
+        {
+            trigrams[trigram].push_back(id);
+        }
+        return id;
+    }
+
+    void ModelSearchIndex::addText(const std::string &text, float weight, bool whole,
+                                   std::unordered_map<uint32_t, float> *weights)
+    {
+        auto add = [&](const std::string &word)
+        {
+            if (word.empty())
+            {
+                return;
+            }
+            float &current = (*weights)[getWordId(toLower(word))];
+            current = std::max(current, weight);
+        };
+        size_t numWords = 0;
+        for (size_t begin = 0; begin < text.size();)
+        {
+            if (!isWordChar(text[begin]))
+            {
+                ++begin;
+                continue;
+            }
+            size_t end = begin;
+            while (end < text.size() && isWordChar(text[end]))
+            {
+                ++end;
+            }
+            const std::string word = text.substr(begin, end - begin);
+            add(word);
+            ++numWords;
+            // RigidBodyState is also found by rigid, body and state
+            size_t partBegin = 0;
+            for (size_t i = 1; i < word.size(); ++i)
+            {
+                if (std::isupper(static_cast<unsigned char>(word[i])) && std::islower(static_cast<unsigned char>(word[i - 1])))
+                {
+                    add(word.substr(partBegin, i - partBegin));
+                    partBegin = i;
+                }
+            }
+            if (partBegin > 0)
+            {
+                add(word.substr(partBegin));
+            }
+            begin = end;
+        }
+        if (whole && numWords > 1)
+        {
+            add(text);
+        }
+    }
+
+    void ModelSearchIndex::update(const std::string &domain, const std::string &name, ConfigMap &model)
+    {
+        remove(domain, name);
+        uint32_t id;
+        if (freeDocuments.empty())
+        {
+            id = documents.size();
+            documents.emplace_back();
+        }
+        else
+        {
+            id = freeDocuments.back();
+            freeDocuments.pop_back();
+        }
+        Document &document = documents[id];
+        document.domain = domain;
+        document.name = name;
+        document.type = model.hasKey("type") ? model["type"].getString() : std::string("");
+        document.alive = true;
+
+        std::unordered_map<uint32_t, float> weights;
+        addText(name, nameWeight, true, &weights);
+        addText(document.type, typeWeight, true, &weights);
+        if (model.hasKey("versions") && model["versions"].size() > 0)
+        {
+            ConfigMap &version = model["versions"][0];
+            if (version.hasKey("interfaces"))
+            {
+                for (auto &interface : version["interfaces"])
+                {
+                    if (interface.hasKey("type"))
+                    {
+                        addText(interface["type"].getString(), interfaceTypeWeight, true, &weights);
+                    }
+                    if (interface.hasKey("name"))
+                    {
+                        addText(interface["name"].getString(), interfaceNameWeight, false, &weights);
+                    }
+                }
+            }
+            if (version.hasKey("data"))
+            {
+                ConfigMap data;
+                try
+                {
+                    if (version["data"].isMap())
+                        data = version["data"];
+                    else
+                        data = ConfigMap::fromYamlString(version["data"].getString());
+                }
+                catch (const std::exception &)
+                {
+                    // a broken data entry only leaves the description out of the index
+                }
+                if (data.hasKey("description") && data["description"].hasKey("markdown"))
+                {
+                    addText(data["description"]["markdown"].getString(), descriptionWeight, false, &weights);
+                }
+            }
+        }
+        document.words.reserve(weights.size());
+        for (const auto &it : weights)
+        {
+            postings[it.first].push_back(Posting{id, it.second});
+            document.words.push_back(it.first);
+        }
+        documentIds[std::make_pair(domain, name)] = id;
+    }
+
+    void ModelSearchIndex::remove(const std::string &domain, const std::string &name)
+    {
+        auto it = documentIds.find(std::make_pair(domain, name));
+        if (it == documentIds.end())
+        {
+            return;
+        }
+        const uint32_t id = it->second;
+        for (uint32_t word : documents[id].words)
+        {
+            std::vector<Posting> &list = postings[word];
+            for (size_t i = 0; i < list.size(); ++i)
+            {
+                if (list[i].document == id)
+                {
+                    list[i] = list.back();
+                    list.pop_back();
+                    break;
+                }
+            }
+        }
+        documents[id] = Document();
+        freeDocuments.push_back(id);
+        documentIds.erase(it);
+    }
+
+    void ModelSearchIndex::clear()
+    {
+        documents.clear();
+        documentIds.clear();
+        freeDocuments.clear();
+        vocabulary.clear();
+        words.clear();
+        postings.clear();
+        trigrams.clear();
+    }
+
+    void ModelSearchIndex::matchWord(const std::string &queryWord, std::vector<std::pair<uint32_t, float>> *matches) const
+    {
+        if (queryWord.size() < 3)
+        {
+            // too short for trigrams, only words starting with it match
+            for (auto it = vocabulary.lower_bound(queryWord);
+                 it != vocabulary.end() && it->first.compare(0, queryWord.size(), queryWord) == 0; ++it)
+            {
+                matches->emplace_back(it->second, it->first.size() == queryWord.size() ? exactMatch : prefixMatch);
+            }
+            return;
+        }
+        // words containing the query word share all of its trigrams, similar words most of them
+        const std::vector<std::string> queryTrigrams = getTrigrams(queryWord);
+        std::unordered_map<uint32_t, uint32_t> shared;
+        for (const auto &trigram : queryTrigrams)
+        {
+            auto it = trigrams.find(trigram);
+            if (it == trigrams.end())
+            {
+                continue;
+            }
+            for (uint32_t word : it->second)
+            {
+                ++shared[word];
+            }
+        }
+        for (const auto &it : shared)
+        {
+            const std::string &word = words[it.first];
+            float quality = 0.0f;
+            size_t position = std::string::npos;
+            if (it.second == queryTrigrams.size())
+            {
+                position = word.find(queryWord);
+            }
+            if (position != std::string::npos)
+            {
+                quality = word.size() == queryWord.size() ? exactMatch : position == 0 ? prefixMatch
+                                                                                        : substringMatch;
+            }
+            else if (queryWord.size() >= minFuzzyLength && word.size() >= 3)
+            {
+                // the trigrams of a word are distinct in almost all cases
+                const float similarity = 2.0f * it.second / (queryTrigrams.size() + word.size() - 2);
+                if (similarity >= minSimilarity)
+                {
+                    quality = fuzzyMatch * similarity;
+                }
+            }
+            if (quality > 0.0f)
+            {
+                matches->emplace_back(it.first, quality);
+            }
+        }
+    }
+
+    std::vector<ModelSearchIndex::Result> ModelSearchIndex::search(const std::string &query, const std::string &domain,
+                                                                   size_t maxResults) const
+    {
+        std::vector<std::string> queryWords;
+        for (size_t begin = 0; begin < query.size();)
+        {
+            if (std::isspace(static_cast<unsigned char>(query[begin])))
+            {
+                ++begin;
+                continue;
+            }
+            size_t end = begin;
+            while (end < query.size() && !std::isspace(static_cast<unsigned char>(query[end])))
+            {
+                ++end;
+            }
+            queryWords.push_back(toLower(query.substr(begin, end - begin)));
+            begin = end;
+        }
+
+        // sum of the best match of each query word per document, for the documents matching all words so far
+        std::vector<float> scores(documents.size(), 0.0f);
+        std::vector<uint32_t> candidates;
+        bool first = true;
+        for (const auto &queryWord : queryWords)
+        {
+            std::vector<std::pair<uint32_t, float>> matches;
+            matchWord(queryWord, &matches);
+            std::vector<float> wordScores(documents.size(), 0.0f);
+            for (const auto &match : matches)
+            {
+                for (const auto &posting : postings[match.first])
+                {
+                    float &score = wordScores[posting.document];
+                    if (first && score == 0.0f)
+                    {
+                        candidates.push_back(posting.document);
+                    }
+                    score = std::max(score, match.second * posting.weight);
+                }
+            }
+            first = false;
+            // every word of the query has to match
+            candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [&](uint32_t document)
+                                            { return wordScores[document] == 0.0f; }),
+                             candidates.end());
+            for (uint32_t document : candidates)
+            {
+                scores[document] += wordScores[document];
+            }
+            if (candidates.empty())
+            {
+                break;
+            }
+        }
+
+        // rank the documents before copying their names into the results
+        candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [&](uint32_t id)
+                                        { return !documents[id].alive || (!domain.empty() && documents[id].domain != domain); }),
+                         candidates.end());
+        auto better = [&](uint32_t a, uint32_t b)
+        {
+            return scores[a] != scores[b] ? scores[a] > scores[b] : documents[a].name < documents[b].name;
+        };
+        if (maxResults > 0 && candidates.size() > maxResults)
+        {
+            std::partial_sort(candidates.begin(), candidates.begin() + maxResults, candidates.end(), better);
+            candidates.resize(maxResults);
+        }
+        else
+        {
+            std::sort(candidates.begin(), candidates.end(), better);
+        }
+        std::vector<Result> results;
+        results.reserve(candidates.size());
+        for (uint32_t id : candidates)
+        {
+            const Document &document = documents[id];
+            results.push_back(Result{document.domain, document.name, document.type, scores[id]});
+        }
+        return results;
+    }
+
+} // end of namespace xrock_gui_model
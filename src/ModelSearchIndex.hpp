@@ -0,0 +1,89 @@
+/**
+ * \file ModelSearchIndex.hpp
+ * \brief Ranked full-text and fuzzy search over the models of any database backend
+ **/
+
+#pragma once
+#include <configmaps/ConfigMap.hpp>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace xrock_gui_model
+{
+
+    /**
+     * @brief Inverted index over model names, types, interfaces and descriptions.
+     *
+     * Every model is indexed with one version (usually the newest). The words of
+     * its name, its type, the types and names of versions[0].interfaces and the
+     * markdown description in versions[0].data are mapped to the models containing
+     * them, weighted by the field they occur in. A query matches a model if each of
+     * its words is a word of the model, a prefix or a substring of one, or similar
+     * to one by shared trigrams. Results are ranked by the quality of the matches.
+     *
+     * The index is not synchronized; build it on one thread and use it on another
+     * only after handing it over.
+     */
+    class ModelSearchIndex
+    {
+    public:
+        struct Result
+        {
+            std::string domain;
+            std::string name;
+            std::string type;
+            float score;
+        };
+
+        // Adds the model or replaces its previous entry. model is a version as returned by
+        // DBInterface::requestModel(domain, name, version, true), it is not modified.
+        void update(const std::string &domain, const std::string &name, configmaps::ConfigMap &model);
+        void remove(const std::string &domain, const std::string &name);
+        void clear();
+        size_t size() const { return documentIds.size(); }
+
+        // Models matching every word of the query, best first. An empty domain searches all domains,
+        // maxResults 0 returns all matches. An empty query matches nothing.
+        std::vector<Result> search(const std::string &query, const std::string &domain = "", size_t maxResults = 0) const;
+
+    private:
+        struct Document
+        {
+            std::string domain;
+            std::string name;
+            std::string type;
+            // words of the model, to remove its postings again
+            std::vector<uint32_t> words;
+            bool alive = false;
+        };
+        struct Posting
+        {
+            uint32_t document;
+            // weight of the most important field containing the word
+            float weight;
+        };
+
+        std::vector<Document> documents;
+        std::map<std::pair<std::string, std::string>, uint32_t> documentIds;
+        // removed documents whose slot can be reused
+        std::vector<uint32_t> freeDocuments;
+        // sorted for prefix lookups
+        std::map<std::string, uint32_t> vocabulary;
+        std::vector<std::string> words;
+        std::vector<std::vector<Posting>> postings;
+        // trigram -> words containing it
+        std::unordered_map<std::string, std::vector<uint32_t>> trigrams;
+
+        uint32_t getWordId(const std::string &word);
+        // Adds the lower case words of text and the parts of camel case words with the given weight,
+        // whole adds the complete text as one more word (e.g. "base::samples::rigidbodystate")
+        void addText(const std::string &text, float weight, bool whole, std::unordered_map<uint32_t, float> *weights);
+        // Best match quality of each word for one word of a query
+        void matchWord(const std::string &queryWord, std::vector<std::pair<uint32_t, float>> *matches) const;
+    };
+
+} // end of namespace xrock_gui_model
@@ -8,6 +8,7 @@
 #include <QPushButton>
 #include <QMessageBox>
 #include <QDesktopServices>
+#include <algorithm>
 #include <array>
 #include "DBInterface.hpp"
 #include "XRockIOLibrary.hpp"
@@ -32,9 +33,13 @@ namespace xrock_gui_model
         {
             backendType = ioLibrary->getBackends();
         }
-        else
+        // the local backends are combined by FederatedDB, also without the xrock_io_library
+        for (const char *local : {"FileDB", "SQLite"})
         {
-            backendType.push_back("FileDB");
+            if (std::find(backendType.begin(), backendType.end(), local) == backendType.end())
+            {
+                backendType.push_back(local);
+            }
         }
         //  Available Databases Label
         QLabel *labelAvailableDatabases = new QLabel("Available Databases:");
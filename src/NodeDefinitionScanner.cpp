@@ -0,0 +1,224 @@
+/**
+ * \file NodeDefinitionScanner.cpp
+ * \brief Reads the yaml files of the node definition directories, shared by all model interfaces
+ **/
+
+#include "NodeDefinitionScanner.hpp"
+#include "utils/ThreadPool.hpp"
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <mutex>
+
+using namespace configmaps;
+
+namespace xrock_gui_model
+{
+
+    namespace
+    {
+        struct Stamp
+        {
+            dev_t device = 0;
+            ino_t inode = 0;
+            off_t size = 0;
+            struct timespec mtime = {0, 0};
+
+            bool operator==(const Stamp &other) const
+            {
+                return (device == other.device && inode == other.inode && size == other.size &&
+                        mtime.tv_sec == other.mtime.tv_sec && mtime.tv_nsec == other.mtime.tv_nsec);
+            }
+        };
+
+        struct Directory
+        {
+            Stamp stamp;
+            bool valid = false;
+            // name and whether it is taken as a directory, in readdir order
+            std::vector<std::pair<std::string, bool>> entries;
+        };
+
+        struct File
+        {
+            Stamp stamp;
+            ConfigMap content;
+        };
+
+        std::mutex cacheMutex;
+        std::map<std::string, Directory> directories;
+        std::map<std::string, File> files;
+
+        bool getStamp(const std::string &path, Stamp *stamp)
+        {
+            struct stat st;
+            if (stat(path.c_str(), &st) != 0)
+            {
+                return false;
+            }
+            stamp->device = st.st_dev;
+            stamp->inode = st.st_ino;
+            stamp->size = st.st_size;
+#ifdef __APPLE__
+            stamp->mtime = st.st_mtimespec;
+#else
+            stamp->mtime = st.st_mtim;
+#endif
+            return true;
+        }
+
+        void readDirectory(const std::string &path, Directory *directory)
+        {
+            directory->entries.clear();
+            DIR *dir = opendir(path.c_str());
+            directory->valid = (dir != NULL);
+            if (!dir)
+            {
+                return;
+            }
+            struct dirent *ent;
+            while ((ent = readdir(dir)) != NULL)
+            {
+                std::string file = ent->d_name;
+                if (file.size() >= 4 && file.compare(file.size() - 4, 4, ".yml") == 0)
+                {
+                    directory->entries.emplace_back(file, false);
+                }
+                else if (file[0] != '.')
+                {
+                    directory->entries.emplace_back(file, true);
+                }
+            }
+            closedir(dir);
+        }
+
+        ThreadPool &getScanPool()
+        {
+            static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+            return pool;
+        }
+
+        void collectFiles(const std::string &path, std::vector<std::string> *result)
+        {
+            const Directory &directory = directories[path];
+            if (!directory.valid)
+            {
+                std::cerr << "Specified path " << path << " is not a valid directory" << std::endl;
+                return;
+            }
+            for (const auto &entry : directory.entries)
+            {
+                if (entry.second)
+                {
+                    collectFiles(path + entry.first + "/", result);
+                }
+                else
+                {
+                    result->push_back(path + entry.first);
+                }
+            }
+        }
+    }
+
+    std::vector<ConfigMap> NodeDefinitionScanner::scan(const std::string &path_)
+    {
+        std::string path = path_;
+        if (path.empty() || path.back() != '/')
+        {
+            path += "/";
+        }
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        ThreadPool &pool = getScanPool();
+
+        // list the directories level by level, only the ones whose stamp changed are read again
+        std::vector<std::string> level{path};
+        while (!level.empty())
+        {
+            std::vector<Directory *> slots;
+            for (const auto &dir : level)
+            {
+                slots.push_back(&directories[dir]);
+            }
+            pool.parallelFor(level.size(), [&](size_t i)
+                             {
+                Stamp stamp;
+                const bool exists = getStamp(level[i], &stamp);
+                if (!exists)
+                {
+                    slots[i]->valid = false;
+                    slots[i]->entries.clear();
+                    slots[i]->stamp = Stamp();
+                }
+                else if (!(slots[i]->stamp == stamp))
+                {
+                    slots[i]->stamp = stamp;
+                    readDirectory(level[i], slots[i]);
+                } });
+            std::vector<std::string> next;
+            for (size_t i = 0; i < level.size(); ++i)
+            {
+                for (const auto &entry : slots[i]->entries)
+                {
+                    if (entry.second)
+                    {
+                        next.push_back(level[i] + entry.first + "/");
+                    }
+                }
+            }
+            level.swap(next);
+        }
+
+        std::vector<std::string> paths;
+        collectFiles(path, &paths);
+
+        // parse the new and changed files
+        std::vector<File *> slots;
+        for (const auto &file : paths)
+        {
+            slots.push_back(&files[file]);
+        }
+        pool.parallelFor(paths.size(), [&](size_t i)
+                         {
+            Stamp stamp;
+            if (!getStamp(paths[i], &stamp))
+            {
+                slots[i]->stamp = Stamp();
+                slots[i]->content = ConfigMap();
+                return;
+            }
+            if (slots[i]->stamp == stamp)
+            {
+                return;
+            }
+            slots[i]->stamp = stamp;
+            try
+            {
+                slots[i]->content = ConfigMap::fromYamlFile(paths[i]);
+            }
+            catch (const std::exception &e)
+            {
+                // remembered with its stamp, so it is not parsed again until it changes
+                slots[i]->content = ConfigMap();
+                std::cerr << "could not read " << paths[i] << ": " << e.what() << std::endl;
+            } });
+
+        std::vector<ConfigMap> result;
+        result.reserve(slots.size());
+        for (const auto *file : slots)
+        {
+            result.push_back(file->content);
+        }
+        return result;
+    }
+
+    void NodeDefinitionScanner::clear()
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        directories.clear();
+        files.clear();
+    }
+
+} // end of namespace xrock_gui_model
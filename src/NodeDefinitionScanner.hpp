@@ -0,0 +1,35 @@
+/**
+ * \file NodeDefinitionScanner.hpp
+ * \brief Reads the yaml files of the node definition directories, shared by all model interfaces
+ **/
+
+#pragma once
+#include <configmaps/ConfigMap.hpp>
+
+#include <string>
+#include <vector>
+
+namespace xrock_gui_model
+{
+
+    /**
+     * @brief Process-wide cache of the node definition files (xrock_node_definitions, OrogenFolder).
+     *
+     * A scan walks the directory tree level by level and parses the files on a
+     * thread pool. The listing of every directory and the content of every file
+     * are kept together with their stamp (inode, size and mtime). A later scan
+     * only stats them and reads again what changed, so a new ComponentModelInterface
+     * does not parse the definitions again.
+     */
+    class NodeDefinitionScanner
+    {
+    public:
+        // Content of every .yml file below path, in the order a depth-first walk of the directories
+        // finds them. Entries starting with '.' are skipped, other entries are taken as directories.
+        // Thread-safe.
+        static std::vector<configmaps::ConfigMap> scan(const std::string &path);
+        // Forgets all cached directories and files
+        static void clear();
+    };
+
+} // end of namespace xrock_gui_model
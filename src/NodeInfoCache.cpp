@@ -0,0 +1,132 @@
+/**
+ * \file NodeInfoCache.cpp
+ * \brief Keeps the node infos derived from the models of a FileDB between sessions
+ **/
+
+#include "NodeInfoCache.hpp"
+#include "FileDB.hpp"
+
+#include <mars/utils/misc.h>
+
+#include <cstdio>
+#include <cstdlib>
+
+using namespace configmaps;
+
+namespace xrock_gui_model
+{
+
+    namespace
+    {
+        // written into the file, a cache of another layout is ignored
+        const std::string cacheFormat = "1";
+
+        std::string getEntryName(const std::string &domain, const std::string &model)
+        {
+            return domain + "/" + model;
+        }
+
+        std::string hashPath(const std::string &path)
+        {
+            // FNV-1a, only used to give every database its own file
+            uint64_t hash = 14695981039346656037ull;
+            for (unsigned char c : path)
+            {
+                hash = (hash ^ c) * 1099511628211ull;
+            }
+            char text[17];
+            snprintf(text, sizeof(text), "%016llx", (unsigned long long)hash);
+            return text;
+        }
+    }
+
+    NodeInfoCache::NodeInfoCache(const std::string &dbPath, const std::string &variant)
+        : dbPath(dbPath), variant(variant), numFound(0)
+    {
+    }
+
+    std::string NodeInfoCache::getDefaultFile(const std::string &dbPath)
+    {
+        std::string dir;
+        const char *cacheHome = getenv("XDG_CACHE_HOME");
+        const char *home = getenv("HOME");
+        if (cacheHome && *cacheHome)
+        {
+            dir = cacheHome;
+        }
+        else if (home && *home)
+        {
+            dir = std::string(home) + "/.cache";
+        }
+        else
+        {
+            return "";
+        }
+        return dir + "/xrock_gui_model/nodeinfo-" + hashPath(dbPath) + ".xpack";
+    }
+
+    bool NodeInfoCache::load(const std::string &file)
+    {
+        entries.clear();
+        numFound = 0;
+        ConfigMap info;
+        if (!snapshot.open(file) || !snapshot.decodeInfo(&info))
+        {
+            snapshot.close();
+            return false;
+        }
+        if (!info.hasKey("format") || info["format"].getString() != cacheFormat ||
+            !info.hasKey("dbPath") || info["dbPath"].getString() != dbPath ||
+            !info.hasKey("variant") || info["variant"].getString() != variant)
+        {
+            snapshot.close();
+            return false;
+        }
+        return true;
+    }
+
+    bool NodeInfoCache::find(const std::string &domain, const std::string &model, const std::string &version,
+                             const FileDBSnapshot::Stamp &stamp, std::string *type, ConfigMap *info)
+    {
+        ConfigMap content;
+        FileDBSnapshot::Stamp cachedStamp;
+        if (!snapshot.findVersion(getEntryName(domain, model), version, &content, &cachedStamp) ||
+            cachedStamp != stamp || !content.hasKey("type") || !content.hasKey("info") || !content["info"].isMap())
+        {
+            return false;
+        }
+        *type = content["type"].getString();
+        ConfigMap &map = content["info"];
+        *info = map;
+        ++numFound;
+        return true;
+    }
+
+    void NodeInfoCache::add(const std::string &domain, const std::string &model, const std::string &version,
+                            const FileDBSnapshot::Stamp &stamp, const std::string &type, const ConfigMap &info)
+    {
+        FileDBSnapshot::Entry entry;
+        entry.model = getEntryName(domain, model);
+        entry.version = version;
+        entry.stamp = stamp;
+        entry.content["type"] = type;
+        entry.content["info"] = info;
+        entries.push_back(std::move(entry));
+    }
+
+    bool NodeInfoCache::isModified() const
+    {
+        return numFound != entries.size() || numFound != snapshot.getNumVersions();
+    }
+
+    bool NodeInfoCache::save(const std::string &file)
+    {
+        ConfigMap info;
+        info["format"] = cacheFormat;
+        info["dbPath"] = dbPath;
+        info["variant"] = variant;
+        mars::utils::createDirectory(fs::path(file).parent_path().string());
+        return FileDB::writeFileAtomic(file, FileDBSnapshot::encode(info, FileDBSnapshot::IndexState(), entries));
+    }
+
+} // end of namespace xrock_gui_model
@@ -0,0 +1,56 @@
+/**
+ * \file NodeInfoCache.hpp
+ * \brief Keeps the node infos derived from the models of a FileDB between sessions
+ **/
+
+#pragma once
+#include <configmaps/ConfigMap.hpp>
+#include "FileDBSnapshot.hpp"
+
+#include <string>
+#include <vector>
+
+namespace xrock_gui_model
+{
+
+    /**
+     * @brief On-disk cache of the node infos registered at startup (initLoadModels).
+     *
+     * The file has the xpack format of FileDBSnapshot: one entry per model
+     * version with the node type and the info map, together with the stamp of
+     * the model file it was derived from. An entry is only used as long as the
+     * model file still has this stamp, so only changed models are converted
+     * again. A cache belongs to one database path and one way of deriving the
+     * node types (variant); the cache of another one is ignored.
+     */
+    class NodeInfoCache
+    {
+    public:
+        NodeInfoCache(const std::string &dbPath, const std::string &variant);
+
+        // nodeinfo-<hash of dbPath>.xpack in $XDG_CACHE_HOME/xrock_gui_model (~/.cache if unset),
+        // empty if there is no cache directory
+        static std::string getDefaultFile(const std::string &dbPath);
+
+        // Maps the cache file. Returns false if it does not exist or belongs to another database or variant.
+        bool load(const std::string &file);
+        // Type and info map of the version, if the cache has them for a model file with this stamp
+        bool find(const std::string &domain, const std::string &model, const std::string &version,
+                  const FileDBSnapshot::Stamp &stamp, std::string *type, configmaps::ConfigMap *info);
+        // Adds an entry to be written by save(). Every version in use has to be added, also the ones found.
+        void add(const std::string &domain, const std::string &model, const std::string &version,
+                 const FileDBSnapshot::Stamp &stamp, const std::string &type, const configmaps::ConfigMap &info);
+        // True if the added entries differ from the loaded file
+        bool isModified() const;
+        // Writes the added entries, the file is replaced
+        bool save(const std::string &file);
+
+    private:
+        std::string dbPath;
+        std::string variant;
+        FileDBSnapshot snapshot;
+        std::vector<FileDBSnapshot::Entry> entries;
+        size_t numFound;
+    };
+
+} // end of namespace xrock_gui_model
@@ -0,0 +1,981 @@
+/**
+ * \file SQLiteDB.cpp
+ * \brief Database backend storing the models in one embedded SQLite file
+ **/
+
+#include "SQLiteDB.hpp"
+#include "BasicModelHelper.hpp"
+
+#include <configmaps/ConfigVector.hpp>
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <QCoreApplication>
+#include <QMessageBox>
+#include <QThread>
+using namespace configmaps;
+
+namespace xrock_gui_model
+{
+
+    namespace
+    {
+        // models without a domain are stored in the SOFTWARE domain, like in FileDB
+        const char *defaultDomain = "SOFTWARE";
+        const char *uriScheme = "sqlite://";
+        // used if the database address is a directory
+        const char *defaultFileName = "models.sqlite";
+        // stored in PRAGMA user_version, a database of a newer schema is not touched
+        const int schemaVersion = 1;
+
+        const char *schema =
+            "CREATE TABLE models ("
+            "  id INTEGER PRIMARY KEY,"
+            "  domain TEXT NOT NULL,"
+            "  name TEXT NOT NULL,"
+            "  type TEXT NOT NULL DEFAULT '',"
+            "  UNIQUE (domain, name));"
+            "CREATE INDEX models_name ON models (name);"
+            // position keeps the order in which the versions were added
+            "CREATE TABLE versions ("
+            "  id INTEGER PRIMARY KEY,"
+            "  model_id INTEGER NOT NULL REFERENCES models (id) ON DELETE CASCADE,"
+            "  name TEXT NOT NULL,"
+            "  position INTEGER NOT NULL,"
+            "  abstract INTEGER NOT NULL DEFAULT 0,"
+            "  body TEXT NOT NULL,"
+            "  UNIQUE (model_id, name));"
+            "CREATE TABLE interfaces ("
+            "  version_id INTEGER NOT NULL REFERENCES versions (id) ON DELETE CASCADE,"
+            "  name TEXT NOT NULL,"
+            "  type TEXT NOT NULL,"
+            "  direction TEXT NOT NULL);"
+            "CREATE INDEX interfaces_type ON interfaces (type);"
+            "CREATE INDEX interfaces_version ON interfaces (version_id);"
+            // models used by the nodes of a version
+            "CREATE TABLE components ("
+            "  version_id INTEGER NOT NULL REFERENCES versions (id) ON DELETE CASCADE,"
+            "  domain TEXT NOT NULL,"
+            "  name TEXT NOT NULL,"
+            "  version TEXT NOT NULL);"
+            "CREATE INDEX components_model ON components (name, version);"
+            "CREATE INDEX components_version ON components (version_id);"
+            // abstract models implemented by a version
+            "CREATE TABLE implements ("
+            "  version_id INTEGER NOT NULL REFERENCES versions (id) ON DELETE CASCADE,"
+            "  domain TEXT NOT NULL,"
+            "  name TEXT NOT NULL,"
+            "  version TEXT NOT NULL);"
+            "CREATE INDEX implements_model ON implements (name, version);"
+            "CREATE INDEX implements_version ON implements (version_id);";
+
+        // Prepared statement which is finalized when it goes out of scope
+        class Statement
+        {
+        public:
+            Statement(sqlite3 *db, const char *sql) : db(db), stmt(nullptr)
+            {
+                if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK)
+                {
+                    std::cerr << "SQLiteDB: " << sqlite3_errmsg(db) << " in " << sql << std::endl;
+                    stmt = nullptr;
+                }
+            }
+            ~Statement() { sqlite3_finalize(stmt); }
+            Statement(const Statement &) = delete;
+            Statement &operator=(const Statement &) = delete;
+
+            Statement &bind(int index, const std::string &value)
+            {
+                sqlite3_bind_text(stmt, index, value.c_str(), value.size(), SQLITE_TRANSIENT);
+                return *this;
+            }
+            Statement &bind(int index, long long value)
+            {
+                sqlite3_bind_int64(stmt, index, value);
+                return *this;
+            }
+            // Returns true while there is a row to read
+            bool step()
+            {
+                if (!stmt)
+                {
+                    return false;
+                }
+                const int result = sqlite3_step(stmt);
+                if (result != SQLITE_ROW && result != SQLITE_DONE)
+                {
+                    std::cerr << "SQLiteDB: " << sqlite3_errmsg(db) << std::endl;
+                    failed = true;
+                }
+                return result == SQLITE_ROW;
+            }
+            // Executes a statement without result rows
+            bool run()
+            {
+                step();
+                return stmt && !failed;
+            }
+            void reset()
+            {
+                sqlite3_reset(stmt);
+                sqlite3_clear_bindings(stmt);
+            }
+            std::string text(int column)
+            {
+                const unsigned char *value = sqlite3_column_text(stmt, column);
+                return value ? std::string(reinterpret_cast<const char *>(value), sqlite3_column_bytes(stmt, column))
+                             : std::string();
+            }
+            long long integer(int column) { return sqlite3_column_int64(stmt, column); }
+
+        private:
+            sqlite3 *db;
+            sqlite3_stmt *stmt;
+            bool failed = false;
+        };
+
+        // Savepoint which is rolled back unless it is committed, savepoints nest unlike BEGIN
+        class Transaction
+        {
+        public:
+            explicit Transaction(sqlite3 *db) : db(db), committed(false)
+            {
+                active = sqlite3_exec(db, "SAVEPOINT xrock", nullptr, nullptr, nullptr) == SQLITE_OK;
+            }
+            ~Transaction()
+            {
+                if (active && !committed)
+                {
+                    sqlite3_exec(db, "ROLLBACK TO xrock; RELEASE xrock", nullptr, nullptr, nullptr);
+                }
+            }
+            bool commit()
+            {
+                committed = active && sqlite3_exec(db, "RELEASE xrock", nullptr, nullptr, nullptr) == SQLITE_OK;
+                return committed;
+            }
+            bool isActive() const { return active; }
+
+        private:
+            sqlite3 *db;
+            bool active;
+            bool committed;
+        };
+
+        std::string getString(ConfigMap &map, const std::string &key)
+        {
+            return map.hasKey(key) ? map[key].getString() : std::string("");
+        }
+
+        bool isSet(ConfigMap &map, const std::string &key)
+        {
+            return map.hasKey(key) && (bool)map[key];
+        }
+
+        // Appends the domain, name and version of the entries of an implements list
+        void addImplements(ConfigMap &map, std::vector<std::tuple<std::string, std::string, std::string>> *implements)
+        {
+            if (!map.hasKey("implements"))
+            {
+                return;
+            }
+            for (auto &entry : map["implements"])
+            {
+                std::string domain, name, version;
+                if (entry.isMap())
+                {
+                    ConfigMap &target = entry;
+                    domain = getString(target, "domain");
+                    name = getString(target, "name");
+                    version = getString(target, "version");
+                }
+                else if (!SQLiteDB::parseUri(entry.getString(), &domain, &name, &version))
+                {
+                    continue;
+                }
+                if (!name.empty())
+                {
+                    implements->emplace_back(domain, name, version);
+                }
+            }
+        }
+    }
+
+    SQLiteDB::SQLiteDB() : db(nullptr), dataVersion(0), nextListenerId(0)
+    {
+    }
+
+    SQLiteDB::~SQLiteDB()
+    {
+        close();
+    }
+
+    void SQLiteDB::warn(const std::string &message)
+    {
+        QCoreApplication *app = QCoreApplication::instance();
+        if (app && QThread::currentThread() == app->thread())
+        {
+            QMessageBox::warning(nullptr, "Warning", QString::fromStdString(message), QMessageBox::Ok);
+        }
+        else
+        {
+            std::cerr << "SQLiteDB: " << message << std::endl;
+        }
+    }
+
+    std::string SQLiteDB::getDbFile() const
+    {
+        if (dbAddress.empty())
+        {
+            return "";
+        }
+        std::error_code ec;
+        if (fs::is_directory(dbAddress, ec))
+        {
+            return (fs::path(dbAddress) / defaultFileName).string();
+        }
+        return dbAddress;
+    }
+
+    bool SQLiteDB::execute(const std::string &sql)
+    {
+        char *error = nullptr;
+        if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &error) != SQLITE_OK)
+        {
+            std::cerr << "SQLiteDB: " << (error ? error : "unknown error") << " in " << sql << std::endl;
+            sqlite3_free(error);
+            return false;
+        }
+        return true;
+    }
+
+    bool SQLiteDB::open(bool create)
+    {
+        if (db)
+        {
+            // commits of other connections change the data version
+            Statement query(db, "PRAGMA data_version");
+            if (query.step() && query.integer(0) != dataVersion)
+            {
+                dataVersion = query.integer(0);
+                notify("", "");
+            }
+            return true;
+        }
+        const std::string file = getDbFile();
+        std::error_code ec;
+        if (file.empty() || (!create && !fs::exists(file, ec)))
+        {
+            return false;
+        }
+        // the connection is only used under dbMutex
+        const int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX | (create ? SQLITE_OPEN_CREATE : 0);
+        if (sqlite3_open_v2(file.c_str(), &db, flags, nullptr) != SQLITE_OK)
+        {
+            warn("could not open " + file + ": " + sqlite3_errmsg(db));
+            close();
+            return false;
+        }
+        sqlite3_busy_timeout(db, 5000);
+        // readers do not block the writer of another process
+        if (!execute("PRAGMA foreign_keys = ON") || !execute("PRAGMA journal_mode = WAL") || !createSchema())
+        {
+            warn("could not open " + file + ": " + sqlite3_errmsg(db));
+            close();
+            return false;
+        }
+        Statement query(db, "PRAGMA data_version");
+        dataVersion = query.step() ? query.integer(0) : 0;
+        return true;
+    }
+
+    void SQLiteDB::close()
+    {
+        sqlite3_close(db);
+        db = nullptr;
+    }
+
+    bool SQLiteDB::createSchema()
+    {
+        Statement query(db, "PRAGMA user_version");
+        const long long version = query.step() ? query.integer(0) : -1;
+        if (version == schemaVersion)
+        {
+            return true;
+        }
+        if (version != 0)
+        {
+            std::cerr << "SQLiteDB: unsupported schema version " << version << std::endl;
+            return false;
+        }
+        Transaction transaction(db);
+        return transaction.isActive() && execute(schema) &&
+               execute("PRAGMA user_version = " + std::to_string(schemaVersion)) && transaction.commit();
+    }
+
+    void SQLiteDB::notify(const std::string &domain, const std::string &model)
+    {
+        std::lock_guard<std::mutex> lock(listenerMutex);
+        for (const auto &listener : listeners)
+        {
+            listener.second(domain, model);
+        }
+    }
+
+    int SQLiteDB::addChangeListener(ChangeListener listener)
+    {
+        std::lock_guard<std::mutex> lock(listenerMutex);
+        listeners[nextListenerId] = listener;
+        return nextListenerId++;
+    }
+
+    void SQLiteDB::removeChangeListener(int id)
+    {
+        std::lock_guard<std::mutex> lock(listenerMutex);
+        listeners.erase(id);
+    }
+
+    std::string SQLiteDB::getUri(const std::string &domain, const std::string &model, const std::string &version)
+    {
+        return uriScheme + domain + "/" + model + (version.empty() ? "" : "/" + version);
+    }
+
+    bool SQLiteDB::parseUri(const std::string &uri, std::string *domain, std::string *model, std::string *version)
+    {
+        const std::string scheme = uriScheme;
+        if (uri.compare(0, scheme.size(), scheme) != 0)
+        {
+            return false;
+        }
+        std::vector<std::string> parts;
+        size_t start = scheme.size(), end;
+        while ((end = uri.find('/', start)) != std::string::npos)
+        {
+            parts.push_back(uri.substr(start, end - start));
+            start = end + 1;
+        }
+        parts.push_back(uri.substr(start));
+        if (parts.size() < 2 || parts.size() > 3 || parts[1].empty())
+        {
+            return false;
+        }
+        *domain = parts[0];
+        *model = parts[1];
+        *version = parts.size() == 3 ? parts[2] : "";
+        return true;
+    }
+
+    void SQLiteDB::setDbAddress(const std::string &dbAddress)
+    {
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
+        close();
+        this->dbAddress = dbAddress;
+    }
+
+    void SQLiteDB::setDbPath(const fs::path &dbPath)
+    {
+        setDbAddress(dbPath.string());
+    }
+
+    bool SQLiteDB::isConnected()
+    {
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
+        return open(false);
+    }
+
+    long long SQLiteDB::findModel(const std::string &domain, const std::string &model, std::string *foundDomain)
+    {
+        Statement query(db, "SELECT id, domain FROM models WHERE (?1 = '' OR domain = ?1) AND name = ?2 ORDER BY domain LIMIT 1");
+        query.bind(1, domain).bind(2, model);
+        if (!query.step())
+        {
+            return -1;
+        }
+        if (foundDomain)
+        {
+            *foundDomain = query.text(1);
+        }
+        return query.integer(0);
+    }
+
+    std::vector<std::pair<std::string, std::string>> SQLiteDB::requestModelListByDomain(const std::string &domain)
+    {
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
+        std::vector<std::pair<std::string, std::string>> modelList;
+        if (!open(false))
+        {
+            return modelList;
+        }
+        Statement query(db, "SELECT name, type FROM models WHERE (?1 = '' OR domain = ?1) ORDER BY id");
+        query.bind(1, domain);
+        while (query.step())
+        {
+            modelList.emplace_back(query.text(0), query.text(1));
+        }
+        return modelList;
+    }
+
+    std::vector<std::string> SQLiteDB::requestVersions(const std::string &domain, const std::string &model)
+    {
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
+        std::vector<std::string> versions;
+        if (!open(false))
+        {
+            return versions;
+        }
+        const long long modelId = findModel(domain, model);
+        Statement query(db, "SELECT name FROM versions WHERE model_id = ? ORDER BY position");
+        query.bind(1, modelId);
+        while (query.step())
+        {
+            versions.push_back(query.text(0));
+        }
+        return versions;
+    }
+
+    ConfigMap SQLiteDB::loadVersion(const std::string &domain, const std::string &model, const std::string &version)
+    {
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
+        ConfigMap map;
+        if (!open(false))
+        {
+            return map;
+        }
+        Statement query(db, "SELECT m.domain, v.body FROM versions v JOIN models m ON m.id = v.model_id "
+                            "WHERE (?1 = '' OR m.domain = ?1) AND m.name = ?2 AND v.name = ?3 ORDER BY m.domain LIMIT 1");
+        query.bind(1, domain).bind(2, model).bind(3, version);
+        if (!query.step())
+        {
+            return map;
+        }
+        const std::string foundDomain = query.text(0);
+        try
+        {
+            map = ConfigMap::fromJsonString(query.text(1));
+        }
+        catch (const std::exception &e)
+        {
+            warn("could not parse " + getUri(foundDomain, model, version) + ": " + e.what());
+            return ConfigMap();
+        }
+        BasicModelHelper::convertFromLegacyModelFormat(map);
+        map["uri"] = getUri(foundDomain, model, version);
+        return map;
+    }
+
+    std::vector<ConfigMap> SQLiteDB::loadVersions(const std::string &domain, const std::string &model,
+                                                  const std::vector<std::string> &versions)
+    {
+        std::vector<std::tuple<std::string, std::string, std::string>> requests;
+        requests.reserve(versions.size());
+        for (const auto &version : versions)
+        {
+            requests.emplace_back(domain, model, version);
+        }
+        return requestModels(requests);
+    }
+
+    ConfigMap SQLiteDB::requestModel(const std::string &domain,
+                                     const std::string &model,
+                                     const std::string &version,
+                                     const bool limit)
+    {
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
+        if (limit)
+        {
+            return loadVersion(domain, model, version);
+        }
+        return requestModelLazy(domain, model).toConfigMap();
+    }
+
+    LazyModel SQLiteDB::requestModelLazy(const std::string &domain, const std::string &model)
+    {
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
+        return LazyModel(
+            requestVersions(domain, model),
+            [this, domain, model](const std::string &version)
+            { return loadVersion(domain, model, version); },
+            [this, domain, model](const std::vector<std::string> &versions)
+            { return loadVersions(domain, model, versions); });
+    }
+
+    std::vector<ConfigMap> SQLiteDB::requestModels(const std::vector<std::tuple<std::string, std::string, std::string>> &models)
+    {
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
+        std::vector<ConfigMap> result(models.size());
+        if (!open(false))
+        {
+            return result;
+        }
+        // one snapshot of the database for all versions
+        Transaction transaction(db);
+        for (size_t i = 0; i < models.size(); ++i)
+        {
+            result[i] = loadVersion(std::get<0>(models[i]), std::get<1>(models[i]), std::get<2>(models[i]));
+        }
+        transaction.commit();
+        return result;
+    }
+
+    std::vector<std::tuple<std::string, std::string, std::string>> SQLiteDB::requestDependents(const std::string &domain,
+                                                                                              const std::string &model,
+                                                                                              const std::string &version)
+    {
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
+        std::vector<std::tuple<std::string, std::string, std::string>> result;
+        if (!open(false))
+        {
+            return result;
+        }
+        Statement query(db, "SELECT DISTINCT m.domain, m.name, v.name, v.position FROM components c "
+                            "JOIN versions v ON v.id = c.version_id JOIN models m ON m.id = v.model_id "
+                            "WHERE c.name = ?2 AND (?1 = '' OR c.domain = ?1) AND (?3 = '' OR c.version = ?3) "
+                            "ORDER BY m.id, v.position");
+        query.bind(1, domain).bind(2, model).bind(3, version);
+        while (query.step())
+        {
+            result.emplace_back(query.text(0), query.text(1), query.text(2));
+        }
+        return result;
+    }
+
+    std::vector<std::tuple<std::string, std::string, std::string>> SQLiteDB::requestModelsByInterfaceType(const std::string &type)
+    {
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
+        std::vector<std::tuple<std::string, std::string, std::string>> result;
+        if (!open(false))
+        {
+            return result;
+        }
+        Statement query(db, "SELECT DISTINCT m.domain, m.name, v.name, v.position FROM interfaces i "
+                            "JOIN versions v ON v.id = i.version_id JOIN models m ON m.id = v.model_id "
+                            "WHERE i.type = ? ORDER BY m.id, v.position");
+        query.bind(1, type);
+        while (query.step())
+        {
+            result.emplace_back(query.text(0), query.text(1), query.text(2));
+        }
+        return result;
+    }
+
+    bool SQLiteDB::storeVersion(ConfigMap &map, std::string *domain)
+    {
+        const std::string model = getString(map, "name");
+        *domain = getString(map, "domain");
+        if (domain->empty())
+        {
+            *domain = defaultDomain;
+            map["domain"] = *domain;
+        }
+        if (model.empty() || !map.hasKey("versions") || map["versions"].size() == 0 ||
+            getString(map["versions"][0], "name").empty())
+        {
+            warn("the model has no name or version");
+            return false;
+        }
+        ConfigMap &versionMap = map["versions"][0];
+        const std::string version = versionMap["name"];
+
+        long long modelId;
+        Statement findModel(db, "SELECT id FROM models WHERE domain = ? AND name = ?");
+        findModel.bind(1, *domain).bind(2, model);
+        if (findModel.step())
+        {
+            modelId = findModel.integer(0);
+        }
+        else
+        {
+            Statement insert(db, "INSERT INTO models (domain, name, type) VALUES (?, ?, ?)");
+            if (!insert.bind(1, *domain).bind(2, model).bind(3, getString(map, "type")).run())
+            {
+                return false;
+            }
+            modelId = sqlite3_last_insert_rowid(db);
+        }
+
+        const long long abstract = isSet(map, "abstract") || isSet(versionMap, "abstract") ? 1 : 0;
+        const std::string body = map.toJsonString();
+        long long versionId;
+        Statement findVersion(db, "SELECT id FROM versions WHERE model_id = ? AND name = ?");
+        findVersion.bind(1, modelId).bind(2, version);
+        if (findVersion.step())
+        {
+            versionId = findVersion.integer(0);
+            Statement update(db, "UPDATE versions SET abstract = ?, body = ? WHERE id = ?");
+            if (!update.bind(1, abstract).bind(2, body).bind(3, versionId).run())
+            {
+                return false;
+            }
+            for (const char *sql : {"DELETE FROM interfaces WHERE version_id = ?",
+                                    "DELETE FROM components WHERE version_id = ?",
+                                    "DELETE FROM implements WHERE version_id = ?"})
+            {
+                Statement remove(db, sql);
+                if (!remove.bind(1, versionId).run())
+                {
+                    return false;
+                }
+            }
+        }
+        else
+        {
+            // a new version is the newest one
+            Statement insert(db, "INSERT INTO versions (model_id, name, position, abstract, body) "
+                                 "VALUES (?1, ?2, (SELECT COALESCE(MAX(position), -1) + 1 FROM versions WHERE model_id = ?1), ?3, ?4)");
+            if (!insert.bind(1, modelId).bind(2, version).bind(3, abstract).bind(4, body).run())
+            {
+                return false;
+            }
+            versionId = sqlite3_last_insert_rowid(db);
+        }
+
+        if (versionMap.hasKey("interfaces"))
+        {
+            Statement insert(db, "INSERT INTO interfaces (version_id, name, type, direction) VALUES (?, ?, ?, ?)");
+            for (auto &item : versionMap["interfaces"])
+            {
+                ConfigMap &interface = item;
+                insert.bind(1, versionId).bind(2, getString(interface, "name"));
+                insert.bind(3, getString(interface, "type")).bind(4, getString(interface, "direction"));
+                if (!insert.run())
+                {
+                    return false;
+                }
+                insert.reset();
+            }
+        }
+        Statement insertComponent(db, "INSERT INTO components (version_id, domain, name, version) VALUES (?, ?, ?, ?)");
+        for (const auto &used : BasicModelHelper::getComponentModels(map))
+        {
+            insertComponent.bind(1, versionId).bind(2, std::get<0>(used)).bind(3, std::get<1>(used)).bind(4, std::get<2>(used));
+            if (!insertComponent.run())
+            {
+                return false;
+            }
+            insertComponent.reset();
+        }
+        std::vector<std::tuple<std::string, std::string, std::string>> implements;
+        addImplements(map, &implements);
+        addImplements(versionMap, &implements);
+        Statement insertImplements(db, "INSERT INTO implements (version_id, domain, name, version) VALUES (?, ?, ?, ?)");
+        for (const auto &target : implements)
+        {
+            insertImplements.bind(1, versionId).bind(2, std::get<0>(target)).bind(3, std::get<1>(target)).bind(4, std::get<2>(target));
+            if (!insertImplements.run())
+            {
+                return false;
+            }
+            insertImplements.reset();
+        }
+        return true;
+    }
+
+    bool SQLiteDB::storeModel(const ConfigMap &map_)
+    {
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
+        ConfigMap map = map_;
+        // the uri is derived from the location, it is not part of the stored model
+        map.erase("uri");
+        BasicModelHelper::convertToLegacyModelFormat(map);
+        if (!open(true))
+        {
+            warn("could not open " + getDbFile());
+            return false;
+        }
+        std::string domain;
+        Transaction transaction(db);
+        if (!transaction.isActive() || !storeVersion(map, &domain) || !transaction.commit())
+        {
+            warn("could not store " + getString(map, "name") + " in " + getDbFile());
+            return false;
+        }
+        notify(domain, map["name"]);
+        return true;
+    }
+
+    bool SQLiteDB::removeModel(const std::string &uri)
+    {
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
+        std::string domain, model, version;
+        if (!parseUri(uri, &domain, &model, &version))
+        {
+            warn("invalid uri: " + uri);
+            return false;
+        }
+        if (!open(false))
+        {
+            return false;
+        }
+        Transaction transaction(db);
+        const long long modelId = findModel(domain, model, &domain);
+        if (modelId < 0)
+        {
+            return false;
+        }
+        if (version.empty())
+        {
+            // the versions and their index entries are deleted by the foreign keys
+            Statement remove(db, "DELETE FROM models WHERE id = ?");
+            if (!remove.bind(1, modelId).run())
+            {
+                return false;
+            }
+        }
+        else
+        {
+            Statement remove(db, "DELETE FROM versions WHERE model_id = ? AND name = ?");
+            if (!remove.bind(1, modelId).bind(2, version).run() || sqlite3_changes(db) == 0)
+            {
+                return false;
+            }
+            Statement removeEmpty(db, "DELETE FROM models WHERE id = ?1 AND NOT EXISTS (SELECT 1 FROM versions WHERE model_id = ?1)");
+            if (!removeEmpty.bind(1, modelId).run())
+            {
+                return false;
+            }
+        }
+        if (!transaction.commit())
+        {
+            warn("could not remove " + uri);
+            return false;
+        }
+        notify(domain, model);
+        return true;
+    }
+
+    bool SQLiteDB::importFrom(DBInterface &source, size_t *numVersions)
+    {
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
+        if (!open(true))
+        {
+            warn("could not open " + getDbFile());
+            return false;
+        }
+        size_t count = 0;
+        Transaction transaction(db);
+        if (!transaction.isActive())
+        {
+            return false;
+        }
+        for (const auto &domain : source.getDomains())
+        {
+            for (const auto &entry : source.requestModelListByDomain(domain))
+            {
+                std::vector<std::tuple<std::string, std::string, std::string>> requests;
+                for (const auto &version : source.requestVersions(domain, entry.first))
+                {
+                    requests.emplace_back(domain, entry.first, version);
+                }
+                std::vector<ConfigMap> maps = source.requestModels(requests);
+                for (size_t i = 0; i < maps.size(); ++i)
+                {
+                    ConfigMap &map = maps[i];
+                    if (map.empty())
+                    {
+                        warn("could not read " + entry.first + "/" + std::get<2>(requests[i]));
+                        return false;
+                    }
+                    map.erase("uri");
+                    BasicModelHelper::convertToLegacyModelFormat(map);
+                    // the source may have resolved a missing or blank domain
+                    map["domain"] = domain;
+                    std::string storedDomain;
+                    if (!storeVersion(map, &storedDomain))
+                    {
+                        warn("could not store " + entry.first + "/" + std::get<2>(requests[i]) + " in " + getDbFile());
+                        return false;
+                    }
+                    ++count;
+                }
+            }
+        }
+        if (!transaction.commit())
+        {
+            warn("could not write " + getDbFile());
+            return false;
+        }
+        if (numVersions)
+        {
+            *numVersions = count;
+        }
+        notify("", "");
+        return true;
+    }
+
+    ConfigMap SQLiteDB::getUnresolvedAbstracts(const std::string &uri)
+    {
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
+        ConfigMap result;
+        result["unresolved_abstracts"] = ConfigVector();
+        std::string domain, model, version;
+        if (!parseUri(uri, &domain, &model, &version) || !open(false))
+        {
+            return result;
+        }
+        ConfigMap map = loadVersion(domain, model, version);
+        if (map.empty())
+        {
+            return result;
+        }
+        BasicModelHelper::convertToLegacyModelFormat(map);
+        ConfigMap &versionMap = map["versions"][0];
+        if (!versionMap.hasKey("components") || !versionMap["components"].hasKey("nodes"))
+        {
+            return result;
+        }
+        Statement isAbstract(db, "SELECT v.abstract FROM versions v JOIN models m ON m.id = v.model_id "
+                                 "WHERE (?1 = '' OR m.domain = ?1) AND m.name = ?2 AND v.name = ?3 ORDER BY m.domain LIMIT 1");
+        Statement implementations(db, "SELECT DISTINCT m.domain, m.name, v.name, m.id, v.position FROM implements i "
+                                      "JOIN versions v ON v.id = i.version_id JOIN models m ON m.id = v.model_id "
+                                      "WHERE i.name = ?2 AND (i.domain = '' OR ?1 = '' OR i.domain = ?1) "
+                                      "AND (i.version = '' OR i.version = ?3) ORDER BY m.id, v.position");
+        for (auto &item : versionMap["components"]["nodes"])
+        {
+            ConfigMap &node = item;
+            if (!node.hasKey("model"))
+            {
+                continue;
+            }
+            const std::string usedDomain = getString(node["model"], "domain");
+            const std::string usedName = getString(node["model"], "name");
+            const std::string usedVersion = getString(node["model"], "version");
+            isAbstract.bind(1, usedDomain).bind(2, usedName).bind(3, usedVersion);
+            const bool abstract = isAbstract.step() && isAbstract.integer(0) != 0;
+            isAbstract.reset();
+            if (!abstract)
+            {
+                continue;
+            }
+            ConfigMap unresolved;
+            unresolved["uri"] = getUri(usedDomain, usedName, usedVersion);
+            unresolved["alias"] = getString(node, "name");
+            unresolved["name"] = usedName;
+            unresolved["version"] = usedVersion;
+            unresolved["implementations"] = ConfigVector();
+            implementations.bind(1, usedDomain).bind(2, usedName).bind(3, usedVersion);
+            while (implementations.step())
+            {
+                ConfigMap implementation;
+                implementation["uri"] = getUri(implementations.text(0), implementations.text(1), implementations.text(2));
+                implementation["name"] = implementations.text(1);
+                implementation["version"] = implementations.text(2);
+                unresolved["implementations"].push_back(implementation);
+            }
+            implementations.reset();
+            result["unresolved_abstracts"].push_back(unresolved);
+        }
+        return result;
+    }
+
+    bool SQLiteDB::buildModule(const std::string &uri, const std::string &moduleName, const std::map<std::string, std::string> &selected_implementations)
+    {
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
+        std::string domain, model, version;
+        if (moduleName.empty() || !parseUri(uri, &domain, &model, &version) || !open(false))
+        {
+            return false;
+        }
+        ConfigMap map = loadVersion(domain, model, version);
+        if (map.empty())
+        {
+            warn("could not find " + uri);
+            return false;
+        }
+        map.erase("uri");
+        BasicModelHelper::convertToLegacyModelFormat(map);
+        map["name"] = moduleName;
+        // the module itself can be used directly
+        map.erase("abstract");
+        ConfigMap &versionMap = map["versions"][0];
+        versionMap.erase("abstract");
+        if (versionMap.hasKey("components") && versionMap["components"].hasKey("nodes"))
+        {
+            for (auto &item : versionMap["components"]["nodes"])
+            {
+                ConfigMap &node = item;
+                if (!node.hasKey("model"))
+                {
+                    continue;
+                }
+                ConfigMap &used = node["model"];
+                auto selected = selected_implementations.find(getUri(getString(used, "domain"), getString(used, "name"),
+                                                                     getString(used, "version")));
+                std::string implDomain, implName, implVersion;
+                if (selected == selected_implementations.end() ||
+                    !parseUri(selected->second, &implDomain, &implName, &implVersion))
+                {
+                    continue;
+                }
+                used["domain"] = implDomain;
+                used["name"] = implName;
+                used["version"] = implVersion;
+            }
+        }
+        std::string storedDomain;
+        Transaction transaction(db);
+        if (!transaction.isActive() || !storeVersion(map, &storedDomain) || !transaction.commit())
+        {
+            warn("could not store " + moduleName + " in " + getDbFile());
+            return false;
+        }
+        notify(storedDomain, moduleName);
+        return true;
+    }
+
+    configmaps::ConfigMap SQLiteDB::getPropertiesOfComponentModel()
+    {
+        configmaps::ConfigMap propMap;
+        propMap["name"]["value"] = "";
+        propMap["name"]["type"] = "string";
+        propMap["type"]["value"] = "";
+        propMap["type"]["type"] = "string";
+        propMap["domain"]["value"] = "";
+        propMap["domain"]["type"] = "array";
+        std::vector<std::string> domains = getDomains();
+        if (std::find(domains.begin(), domains.end(), defaultDomain) == domains.end())
+        {
+            domains.insert(domains.begin(), defaultDomain);
+        }
+        for (const auto &domain : domains)
+        {
+            propMap["domain"]["allowed_values"].push_back(ConfigItem(domain));
+        }
+        propMap["project"]["value"] = "";
+        propMap["project"]["type"] = "string";
+        return propMap;
+    }
+
+    std::vector<std::string> SQLiteDB::getDomains()
+    {
+        std::lock_guard<std::recursive_mutex> lock(dbMutex);
+        std::vector<std::string> domains;
+        if (open(false))
+        {
+            Statement query(db, "SELECT DISTINCT domain FROM models ORDER BY domain");
+            while (query.step())
+            {
+                domains.push_back(query.text(0));
+            }
+        }
+        if (domains.empty())
+        {
+            domains.push_back(defaultDomain);
+        }
+        return domains;
+    }
+
+    configmaps::ConfigMap SQLiteDB::getEmptyComponentModel()
+    {
+        configmaps::ConfigMap emptyModel;
+        emptyModel["name"] = "";
+        emptyModel["domain"] = "SOFTWARE";
+        configmaps::ConfigMap emptyVersion;
+        emptyVersion["name"] = "v0.0.0";
+        emptyModel["versions"].push_back(emptyVersion);
+        return emptyModel;
+    }
+
+} // end of namespace xrock_gui_model
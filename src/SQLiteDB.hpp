@@ -0,0 +1,119 @@
+/**
+ * \file SQLiteDB.hpp
+ * \brief Database backend storing the models in one embedded SQLite file
+ **/
+
+#pragma once
+#include <configmaps/ConfigMap.hpp>
+#include "DBInterface.hpp"
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+struct sqlite3;
+
+namespace xrock_gui_model
+{
+
+    /**
+     * @brief DBInterface implementation on top of a SQLite database file.
+     *
+     * Every model version is stored as a json blob in the legacy model format
+     * (the content of a FileDB model.yml). The tables models, versions, interfaces,
+     * components and implements index the versions by domain, name and version,
+     * the types of their interfaces, the models they use and the abstract models
+     * they implement, so listings, requestDependents() and getUnresolvedAbstracts()
+     * do not parse any blob.
+     *
+     * A version is abstract if it or its model has "abstract: true". The
+     * "implements" list of a version or its model names the abstract models it
+     * implements by domain, name and version.
+     *
+     * The database file is created by the first storeModel(). Other processes may
+     * use the same file; their changes are reported to the change listeners with an
+     * empty model once this instance accesses the database again.
+     */
+    class SQLiteDB : public DBInterface
+    {
+    public:
+        SQLiteDB();
+        ~SQLiteDB();
+
+        // An empty domain lists the models of all domains
+        std::vector<std::pair<std::string, std::string>> requestModelListByDomain(const std::string &domain) override;
+        std::vector<std::string> requestVersions(const std::string &domain, const std::string &model) override;
+        configmaps::ConfigMap requestModel(const std::string &domain,
+                                           const std::string &model,
+                                           const std::string &version,
+                                           const bool limit = false) override;
+        LazyModel requestModelLazy(const std::string &domain, const std::string &model) override;
+        // Reads all versions in one transaction
+        std::vector<configmaps::ConfigMap> requestModels(const std::vector<std::tuple<std::string, std::string, std::string>> &models) override;
+        std::vector<std::tuple<std::string, std::string, std::string>> requestDependents(const std::string &domain,
+                                                                                        const std::string &model,
+                                                                                        const std::string &version) override;
+        bool storeModel(const configmaps::ConfigMap &map) override;
+        // Removes a version ("sqlite://<domain>/<model>/<version>") or all versions ("sqlite://<domain>/<model>")
+        bool removeModel(const std::string &uri) override;
+        // The database file, or a directory holding models.sqlite
+        void setDbAddress(const std::string &dbAddress) override;
+        void setDbPath(const fs::path &dbPath) override;
+        bool isConnected() override;
+        int addChangeListener(ChangeListener listener) override;
+        void removeChangeListener(int id) override;
+        configmaps::ConfigMap getPropertiesOfComponentModel() override;
+        // Domains of the models in the database, SOFTWARE if it is empty
+        std::vector<std::string> getDomains() override;
+        configmaps::ConfigMap getEmptyComponentModel() override;
+        // Stores a copy of the model named moduleName in which the nodes of the selected abstract models use their implementation
+        bool buildModule(const std::string &uri, const std::string &moduleName, const std::map<std::string, std::string> &selected_implementations) override;
+        // The abstract models used directly by the nodes of the model and the known implementations of each
+        configmaps::ConfigMap getUnresolvedAbstracts(const std::string &uri) override;
+
+        // Domain, name and version of the model versions having an interface of the given type
+        std::vector<std::tuple<std::string, std::string, std::string>> requestModelsByInterfaceType(const std::string &type);
+
+        // Copies all versions of all models of source into this database in one transaction,
+        // existing versions are replaced
+        bool importFrom(DBInterface &source, size_t *numVersions = nullptr);
+
+        std::string getDbFile() const;
+
+        static std::string getUri(const std::string &domain, const std::string &model, const std::string &version);
+        // Splits a uri created by getUri(), the version is empty if the uri names a whole model
+        static bool parseUri(const std::string &uri, std::string *domain, std::string *model, std::string *version);
+
+    private:
+        std::string dbAddress;
+        // Serializes the public functions, so the database can be used from a worker thread (see AsyncDB)
+        // while the GUI thread still calls it directly. Recursive because LazyModel loads re-enter.
+        std::recursive_mutex dbMutex;
+        sqlite3 *db;
+        // PRAGMA data_version of the last access, it changes with commits of other connections
+        long long dataVersion;
+        std::map<int, ChangeListener> listeners;
+        int nextListenerId;
+        std::mutex listenerMutex;
+
+        static void warn(const std::string &message);
+        // Opens the database file, create also creates it and the schema if missing.
+        // Returns false without a warning if the file does not exist and create is false.
+        bool open(bool create);
+        void close();
+        bool createSchema();
+        bool execute(const std::string &sql);
+        void notify(const std::string &domain, const std::string &model);
+
+        // id of the model or -1, an empty domain matches any domain
+        long long findModel(const std::string &domain, const std::string &model, std::string *foundDomain = nullptr);
+        configmaps::ConfigMap loadVersion(const std::string &domain, const std::string &model, const std::string &version);
+        std::vector<configmaps::ConfigMap> loadVersions(const std::string &domain, const std::string &model,
+                                                        const std::vector<std::string> &versions);
+        // Writes a model with one version in the legacy format, the caller holds a transaction
+        bool storeVersion(configmaps::ConfigMap &map, std::string *domain);
+    };
+
+} // end of namespace xrock_gui_model
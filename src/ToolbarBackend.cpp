@@ -20,6 +20,7 @@
 #include <QLabel>
 #include <QComboBox>
 #include <QVBoxLayout>
+#include <algorithm>
 #include <cstdlib>
 #include <mars/utils/misc.h>
 using namespace xrock_gui_model;
@@ -41,6 +42,14 @@ ToolbarBackend::ToolbarBackend(XRockGUI *xrockGui, mars::main_gui::GuiInterface
     {
         backends.push_back("FileDB");
     }
+    // the SQLite backend and the combination of local backends are built in
+    for (const char *builtIn : {"SQLite", "MultiDbClient"})
+    {
+        if (std::find(backends.begin(), backends.end(), builtIn) == backends.end())
+        {
+            backends.push_back(builtIn);
+        }
+    }
     for (auto const &e : backends)
         cbBackends->addItem(QString::fromStdString(e));
     cbBackends->setCurrentIndex(cbBackends->findText(QString::fromStdString(xrockGui->getBackend()), Qt::MatchFixedString));
@@ -156,6 +165,11 @@ void ToolbarBackend::hideToolbarWidgets(const QString &backend)
     {
         configDialogAction->setVisible(false);
     }
+    else if (backend == "SQLite")
+    {
+        widgetActionPath->setVisible(false);
+        ActionLabelPath->setVisible(false);
+    }
 }
 void ToolbarBackend::showToolbarWidgets(const QString &backend)
 {
@@ -186,6 +200,16 @@ void ToolbarBackend::showToolbarWidgets(const QString &backend)
         ActionLabelGraph->setVisible(false);
         configDialogAction->setVisible(true);
     }
+    else if (backend == "SQLite")
+    {
+        // the db path names the database file or its directory
+        hideToolbarWidgets("Client");
+        widgetActionPath->setVisible(true);
+        ActionLabelPath->setVisible(true);
+        widgetActionGraphS->setVisible(false);
+        ActionLabelGraph->setVisible(false);
+        configDialogAction->setVisible(false);
+    }
 }
 
 void ToolbarBackend::onBackendChanged(const QString &newBackend)
@@ -207,6 +231,10 @@ void ToolbarBackend::onBackendChanged(const QString &newBackend)
     {
         xrockGui->menuAction(static_cast<int>(MenuActions::SELECT_FILEDB));
     }
+    else if (newBackend == "SQLite")
+    {
+        xrockGui->menuAction(static_cast<int>(MenuActions::SELECT_SQLITE));
+    }
     else
     {
         throw std::runtime_error("Unhandled backend type " + newBackend.toStdString());
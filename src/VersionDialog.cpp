@@ -47,9 +47,10 @@ namespace xrock_gui_model
     {
         selectedDomain = domain;
         selectedModel = name;
-        std::vector<std::string> versionList = xrockGui->db->requestVersions(domain, name);
+        componentVersions = xrockGui->db->requestModelLazy(domain, name);
+        const std::vector<std::string> &versionList = componentVersions.getVersionNames();
         versions->clear();
-        for (std::vector<std::string>::iterator it = versionList.begin(); it != versionList.end(); ++it)
+        for (std::vector<std::string>::const_iterator it = versionList.begin(); it != versionList.end(); ++it)
         {
             versions->addItem((*it).c_str());
         }
@@ -62,7 +63,11 @@ namespace xrock_gui_model
         {
             selectedVersion = v.toString().toStdString();
             dw->clearGUI();
-            ConfigMap map = xrockGui->db->requestModel(selectedDomain, selectedModel, selectedVersion);
+            int index = componentVersions.findVersion(selectedVersion);
+            if (index < 0)
+                return;
+            // only the clicked version is loaded
+            ConfigMap map = componentVersions.getVersion(index);
             dw->setConfigMap("", map);
         }
     }
@@ -6,6 +6,7 @@
 
 #pragma once
 #include <configmaps/ConfigData.h>
+#include "LazyModel.hpp"
 
 #include <QDialog>
 #include <QListWidget>
@@ -44,6 +45,8 @@ namespace xrock_gui_model
         std::string selectedVersion;
         XRockGUI *xrockGui;
         configmaps::ConfigMap component;
+        // versions of the requested component; their content is loaded when clicked
+        LazyModel componentVersions;
     };
 } // end of namespace xrock_gui_model
 
@@ -10,6 +10,12 @@
 #include "ImportDialog.hpp"
 #include "BasicModelHelper.hpp"
 #include "FileDB.hpp"
+#include "SQLiteDB.hpp"
+#include "FederatedDB.hpp"
+#include "AsyncDB.hpp"
+#include "ModelSearchCache.hpp"
+#include "CachingDB.hpp"
+#include "NodeInfoCache.hpp"
 
 #include "MultiDBConfigDialog.hpp"
 #include "VersionDialog.hpp"
@@ -114,6 +120,10 @@ namespace xrock_gui_model
                 {
                     defaultAddress = "http://localhost:8183";
                 }
+                else if (env["dbType"] == "SQLite")
+                {
+                    defaultAddress += ".sqlite";
+                }
             }
             else
             {
@@ -139,7 +149,12 @@ namespace xrock_gui_model
 	    {
 	        ioLibrary = libManager->getLibraryAs<XRockIOLibrary>("xrock_io_library", false);
 	    }
-            if(ioLibrary)
+            if(env["dbType"] == "SQLite")
+            {
+                // built in like FileDB, the xrock_io_library only provides the other backends
+                db.reset(createCachingDB(new SQLiteDB()));
+            }
+            else if(ioLibrary)
             {
                 ConfigMap dbConfig = ioLibrary->getDefaultConfig();
                 if(!dbConfig.empty())
@@ -153,40 +168,47 @@ namespace xrock_gui_model
                         env["dbType"] = "Serverless";
                         env["dbPath"] = config["dbPath"];
                         env["dbGraph"] = config["dbGraph"];
-                        db.reset(ioLibrary->getDB(env));
+                        db.reset(createCachingDB(ioLibrary->getDB(env)));
                     }
                     else if(dbType == "Client")
                     {
                         env["dbType"] = "Client";
-                        db.reset(ioLibrary->getDB(env));
+                        db.reset(createCachingDB(ioLibrary->getDB(env)));
                         db->setDbAddress(config["url"]);
                     }
                     else if(dbType == "MultiDbClient")
                     {
                         env["dbType"] = "MultiDbClient";
                         env["multiDBConfig"] = config.toJsonString();
-                        db.reset(ioLibrary->getDB(env));
+                        db.reset(createCachingDB(ioLibrary->getDB(env)));
                         fprintf(stderr, "---    Set MultiDB from default config\n");
                     }
                     else
                     {
                         // todo: print error config db key wrong
-                        db.reset(ioLibrary->getDB(env));
+                        db.reset(createCachingDB(ioLibrary->getDB(env)));
                     }
                 }
                 else
                 {
-                    db.reset(ioLibrary->getDB(env));
+                    db.reset(createCachingDB(ioLibrary->getDB(env)));
                 }
             }
+            else if(env["dbType"] == "MultiDbClient" && mars::utils::pathExists(confDir + "/MultiDBConfig.yml"))
+            {
+                // the FileDB and SQLite servers of a MultiDbClient setup work without the xrock_io_library
+                ConfigMap multidb_config = ConfigMap::fromYamlFile(confDir + "/MultiDBConfig.yml");
+                env["multiDBConfig"] = multidb_config.toJsonString();
+                db.reset(createCachingDB(createFederatedDB(multidb_config)));
+            }
             else
             {
                 env["backend"] = "FileDB";
                 env["dbType"] = "FileDB";
                 // if we don't have a ioLibrary we only support FileDB
-               db.reset(new FileDB());
+               db.reset(createCachingDB(createFileDB()));
             }
-            if(env["dbType"] == "FileDB")
+            if(env["dbType"] == "FileDB" || env["dbType"] == "SQLite")
             {
                 prop_dbAddress.sValue = mars::utils::pathJoin(confDir, prop_dbAddress.sValue);
                 db->setDbAddress(prop_dbAddress.sValue);
@@ -197,6 +219,93 @@ namespace xrock_gui_model
             std::cerr << "Error: Failed to load library cfg_manager!" << std::endl;
     }
 
+    DBInterface *XRockGUI::createFileDB()
+    {
+        size_t numLoadThreads = 0;
+        if (env.hasKey("fileDBLoadThreads"))
+        {
+            numLoadThreads = (int)env["fileDBLoadThreads"];
+        }
+        FileDB *fileDB = new FileDB(numLoadThreads);
+        // notice changes of other tools writing into the database while the gui is open
+        fileDB->setWatchChanges(!env.hasKey("fileDBWatch") || (bool)env["fileDBWatch"]);
+        // identical model versions share one file on disk
+        fileDB->setDeduplicate(env.hasKey("fileDBDeduplicate") && (bool)env["fileDBDeduplicate"]);
+        // older versions of large models are stored as differences to their successor
+        if (env.hasKey("fileDBDeltaKeyframes"))
+        {
+            fileDB->setDeltaKeyframeInterval((int)env["fileDBDeltaKeyframes"]);
+        }
+        if (env.hasKey("fileDBFormat"))
+        {
+            fileDB->setModelFormat(env["fileDBFormat"].getString() == "json" ? FileDB::JSON : FileDB::YAML);
+        }
+        if (env.hasKey("fileDBCompression"))
+        {
+            FileCompression::Format format;
+            if (FileCompression::parseFormat(env["fileDBCompression"].getString(), &format) && FileCompression::isSupported(format))
+            {
+                fileDB->setCompression(format);
+            }
+            else
+            {
+                std::cerr << "XRockGUI: unsupported fileDBCompression " << env["fileDBCompression"].getString() << std::endl;
+            }
+        }
+        return fileDB;
+    }
+
+    CachingDB *XRockGUI::createCachingDB(DBInterface *backend)
+    {
+        size_t cacheSize = 256;
+        if (env.hasKey("modelCacheSize"))
+        {
+            cacheSize = (int)env["modelCacheSize"];
+        }
+        if (!backend)
+        {
+            return nullptr;
+        }
+        // also used with a size of 0, the CachingDB serializes the calls of the GUI thread and the AsyncDB worker
+        return new CachingDB(backend, cacheSize);
+    }
+
+    DBInterface *XRockGUI::createFederatedDB(const ConfigMap &config)
+    {
+        FederatedDB *federatedDB = new FederatedDB();
+        const char *root = getenv("AUTOPROJ_CURRENT_ROOT");
+        federatedDB->loadConfig(config, root ? root : "", [this](const ConfigMap &server_) -> DBInterface *
+                                {
+            ConfigMap server = server_;
+            const std::string type = server["type"];
+            if (type == "FileDB")
+            {
+                DBInterface *fileDB = createFileDB();
+                fileDB->setDbAddress(server["path"]);
+                return fileDB;
+            }
+            if (type == "SQLite" || !ioLibrary)
+            {
+                return FederatedDB::createLocalBackend(server, "");
+            }
+            // Serverless and Client servers are provided by the xrock_io_library
+            ConfigMap dbEnv = env;
+            dbEnv["dbType"] = type;
+            dbEnv["dbPath"] = server["path"];
+            dbEnv["dbGraph"] = server["graph"];
+            DBInterface *backend = ioLibrary->getDB(dbEnv);
+            if (backend)
+            {
+                backend->setDbGraph(server["graph"]);
+                if (type == "Client")
+                {
+                    backend->setDbAddress(server["url"]);
+                }
+            }
+            return backend; });
+        return federatedDB;
+    }
+
     void XRockGUI::initBagelGui()
     {
         bagelGui = libManager->getLibraryAs<BagelGui>("bagel_gui");
@@ -206,7 +315,8 @@ namespace xrock_gui_model
             bagelGui->addPlugin(this);
             // NOTE: addModelInterface() is actually a registerModelInterface() function to setup a factory
             ComponentModelInterface* model = new ComponentModelInterface(bagelGui, this);
-            if(env["dbType"] == "FileDB")
+            const bool simpleTypeGen = (env["dbType"] == "FileDB" || env["dbType"] == "SQLite");
+            if(simpleTypeGen)
             {
                 model->setSimpleTypeGen();
             }
@@ -215,12 +325,7 @@ namespace xrock_gui_model
             // Preload the canvas with already defined models
             if (env.hasKey("initLoadModels") and (bool)env["initLoadModels"] == true)
             {
-                std::vector<std::pair<std::string, std::string>> models = db->requestModelListByDomain("SOFTWARE");
-                for(auto it: models)
-                {
-                    ConfigMap modelMap = db->requestModel("SOFTWARE", it.first, "");
-                    model->addNodeInfo(model->deriveTypeFromNodeInfo(modelMap), modelMap);
-                }
+                preloadNodeInfos(model, simpleTypeGen);
             }
         }
         else
@@ -229,6 +334,84 @@ namespace xrock_gui_model
         }
     }
 
+    void XRockGUI::preloadNodeInfos(ComponentModelInterface *model, bool simpleTypeGen)
+    {
+        // only the first version is used for the node info
+        std::vector<std::tuple<std::string, std::string, std::string>> requests;
+        for(const auto &domain: db->getDomains())
+        {
+            for(auto it: db->requestModelListByDomain(domain))
+            {
+                std::vector<std::string> versions = db->requestVersions(domain, it.first);
+                if(versions.empty())
+                    continue;
+                requests.push_back(std::make_tuple(domain, it.first, versions.front()));
+            }
+        }
+
+        // the node infos of FileDB models are kept between sessions unless "nodeInfoCache" is false,
+        // only the models whose files changed since are converted again
+        FileDB *fileDB = nullptr;
+        if (!env.hasKey("nodeInfoCache") || (bool)env["nodeInfoCache"])
+        {
+            fileDB = db ? dynamic_cast<FileDB *>(db->getBackend()) : nullptr;
+        }
+        std::unique_ptr<NodeInfoCache> cache;
+        std::string cacheFile;
+        if (fileDB)
+        {
+            cacheFile = NodeInfoCache::getDefaultFile(fileDB->getDbAddress());
+            if (!cacheFile.empty())
+            {
+                cache.reset(new NodeInfoCache(fileDB->getDbAddress(), simpleTypeGen ? "simple" : "full"));
+                cache->load(cacheFile);
+            }
+        }
+
+        std::vector<std::tuple<std::string, std::string, std::string>> missing;
+        std::vector<FileDBSnapshot::Stamp> stamps;
+        std::vector<char> stamped;
+        for (const auto &request : requests)
+        {
+            const std::string &domain = std::get<0>(request);
+            const std::string &name = std::get<1>(request);
+            const std::string &version = std::get<2>(request);
+            FileDBSnapshot::Stamp stamp;
+            const bool hasStamp = cache && fileDB->getVersionStamp(name, version, &stamp);
+            std::string type;
+            ConfigMap info;
+            if (hasStamp && cache->find(domain, name, version, stamp, &type, &info))
+            {
+                model->restoreNodeInfo(type, info);
+                cache->add(domain, name, version, stamp, type, info);
+                continue;
+            }
+            missing.push_back(request);
+            stamps.push_back(stamp);
+            stamped.push_back(hasStamp);
+        }
+
+        // fetch the others in one batch
+        std::vector<ConfigMap> modelMaps = db->requestModels(missing);
+        for (size_t i = 0; i < modelMaps.size(); ++i)
+        {
+            if(modelMaps[i].empty())
+                continue;
+            const std::string type = model->deriveTypeFromNodeInfo(modelMaps[i]);
+            model->addNodeInfo(type, modelMaps[i]);
+            if (stamped[i])
+            {
+                // also if the type was known already, the first version registering it wins again next time
+                cache->add(std::get<0>(missing[i]), std::get<1>(missing[i]), std::get<2>(missing[i]),
+                           stamps[i], type, model->getNodeInfo(type));
+            }
+        }
+        if (cache && cache->isModified() && !cache->save(cacheFile))
+        {
+            std::cerr << "XRockGUI: could not write the node info cache " << cacheFile << std::endl;
+        }
+    }
+
     void XRockGUI::initMainGui()
     {
         gui = libManager->getLibraryAs<mars::main_gui::GuiInterface>("main_gui");
@@ -300,6 +483,9 @@ namespace xrock_gui_model
 
     XRockGUI::~XRockGUI()
     {
+        // finish the running request while the backend library is still loaded
+        searchCache.reset();
+        asyncDb.reset();
         widget->deinit();
         if (gui)
             libManager->releaseLibrary("main_gui");
@@ -455,12 +641,14 @@ namespace xrock_gui_model
             }
             case MenuActions::STORE_MODEL_TO_DB: // store model
             {
-                if (!storeComponentModel())
-                {
-                    QMessageBox::critical(nullptr, "Error", "Could not store component model to database", QMessageBox::Ok);
-                    break;
-                }
-                QMessageBox::information(nullptr, "Success", "Component model has been successfully stored into database", QMessageBox::Ok);
+                storeComponentModel([](bool saved)
+                                    {
+                    if (!saved)
+                    {
+                        QMessageBox::critical(nullptr, "Error", "Could not store component model to database", QMessageBox::Ok);
+                        return;
+                    }
+                    QMessageBox::information(nullptr, "Success", "Component model has been successfully stored into database", QMessageBox::Ok); });
                 break;
             }
             case MenuActions::BUILD_MODULE_TO_DB: // save and build module
@@ -747,7 +935,7 @@ namespace xrock_gui_model
                 {
                     env["dbType"] = "Serverless";
                     env["dbPath"] = toolbarBackend->getDbPath();
-                    db.reset(ioLibrary->getDB(env));
+                    db.reset(createCachingDB(ioLibrary->getDB(env)));
                     db->setDbGraph(toolbarBackend->getGraph());
                 }
                 break;
@@ -759,7 +947,7 @@ namespace xrock_gui_model
                     env["dbType"] = "Client";
                     env["dbAddress"] = toolbarBackend->getDbAddress();
                     env["dbGraph"] = toolbarBackend->getGraph();
-                    db.reset(ioLibrary->getDB(env));
+                    db.reset(createCachingDB(ioLibrary->getDB(env)));
                     db->setDbGraph(toolbarBackend->getGraph());
                     db->setDbAddress(toolbarBackend->getDbAddress());
                     if (!db->isConnected())
@@ -773,24 +961,26 @@ namespace xrock_gui_model
 
             case MenuActions::SELECT_MULTIDB: // MultiDbClient
             {
-                if (ioLibrary)
+                std::string multidb_config_path = bagelGui->getConfigDir() + "/MultiDBConfig.yml";
+                MultiDBConfigDialog dialog(multidb_config_path, ioLibrary);
+                dialog.exec();
+                if (mars::utils::pathExists(multidb_config_path))
                 {
-                    std::string multidb_config_path = bagelGui->getConfigDir() + "/MultiDBConfig.yml";
-                    MultiDBConfigDialog dialog(multidb_config_path, ioLibrary);
-                    dialog.exec();
-                    if (mars::utils::pathExists(multidb_config_path))
+                    ConfigMap multidb_config = configmaps::ConfigMap::fromYamlFile(multidb_config_path);
+                    env["dbType"] = "MultiDbClient";
+                    env["multiDBConfig"] = multidb_config.toJsonString();
+                    if (!ioLibrary || FederatedDB::hasLocalServers(multidb_config))
                     {
-                        ConfigMap multidb_config = configmaps::ConfigMap::fromYamlFile(multidb_config_path);
-                        env["dbType"] = "MultiDbClient";
-                        env["multiDBConfig"] = multidb_config.toJsonString();
-                        db.reset(ioLibrary->getDB(env));
-                        if (multidb_config["main_server"]["type"] == "Client" or
-                            std::any_of(multidb_config["import_servers"].begin(), multidb_config["import_servers"].end(), [](ConfigItem &is)
-                                        { return is["type"] == "Client"; }))
-                        {
-                            std::string msg = "MultiDB is requesting a client server! Please run server using command:\njsondb -d YOUR_DB_PATH";
-                            QMessageBox::warning(nullptr, "Warning", msg.c_str(), QMessageBox::Ok);
-                        }
+                        db.reset(createCachingDB(createFederatedDB(multidb_config)));
+                        break;
+                    }
+                    db.reset(createCachingDB(ioLibrary->getDB(env)));
+                    if (multidb_config["main_server"]["type"] == "Client" or
+                        std::any_of(multidb_config["import_servers"].begin(), multidb_config["import_servers"].end(), [](ConfigItem &is)
+                                    { return is["type"] == "Client"; }))
+                    {
+                        std::string msg = "MultiDB is requesting a client server! Please run server using command:\njsondb -d YOUR_DB_PATH";
+                        QMessageBox::warning(nullptr, "Warning", msg.c_str(), QMessageBox::Ok);
                     }
                 }
                 break;
@@ -799,10 +989,17 @@ namespace xrock_gui_model
             {
                 if (!ioLibrary)
                 {
-                    db.reset(new FileDB());
+                    db.reset(createCachingDB(createFileDB()));
                 }
                 break;
             }
+            case MenuActions::SELECT_SQLITE: // SQLite
+            {
+                env["dbType"] = "SQLite";
+                db.reset(createCachingDB(new SQLiteDB()));
+                db->setDbPath(mars::utils::pathJoin(std::getenv("AUTOPROJ_CURRENT_ROOT"), toolbarBackend->getDbPath()));
+                break;
+            }
             case MenuActions::RELOAD_MODEL_FROM_DB: // Reload
             {
                 if (ModelInterface *m = bagelGui->getCurrentModel())
@@ -896,7 +1093,12 @@ namespace xrock_gui_model
             handleFilenamePrefix(&graphFile, env["wsd"]);
 
             // check if we can load a model as template
-            ConfigMap map = db->requestModel(domain, name, "template");
+            ConfigMap map;
+            LazyModel versions = db->requestModelLazy(domain, name);
+            if (!versions.empty())
+            {
+                map = versions.getVersion(0);
+            }
             // if the map is empty create the model info
             if (map.empty())
             {
@@ -941,7 +1143,23 @@ namespace xrock_gui_model
             std::string name = "bagel::" + localMap["name"].getString();
             std::string version = localMap["name"];
             // check if we can load the model from the database
-            ConfigMap map = db->requestModel(domain, name, version);
+            // NOTE: Only the first version and the requested version are loaded
+            ConfigMap map;
+            ConfigMap versionMap;
+            LazyModel versions = db->requestModelLazy(domain, name);
+            if (!versions.empty())
+            {
+                map = versions.getVersion(0);
+                int index = versions.findVersion(version);
+                if (index >= 0)
+                {
+                    ConfigMap versionModel = versions.getVersion(index);
+                    if (versionModel.hasKey("versions"))
+                    {
+                        versionMap = versionModel["versions"][0];
+                    }
+                }
+            }
             // if the map is empty create the model info
             if (map.empty())
             {
@@ -974,18 +1192,6 @@ namespace xrock_gui_model
             }
             if (motorMap.hasKey("motors"))
             {
-                ConfigMap versionMap;
-                if (map.hasKey("versions"))
-                {
-                    for (auto it : map["versions"])
-                    {
-                        if (it["name"] == version)
-                        {
-                            versionMap = it;
-                            break;
-                        }
-                    }
-                }
                 ConfigVector::iterator it = motorMap["motors"].begin();
                 double step = 22.0;
                 double n = (motorMap["motors"].size() * 1.) * step;
@@ -1098,32 +1304,57 @@ namespace xrock_gui_model
         currentModelChanged(model);
     }
 
-    // This function loads a component model from DB
+    // This function loads a component model from DB, the model is opened once the request finished
     void XRockGUI::loadComponentModel(const std::string &domain, const std::string &modelName, const std::string &version)
     {
-        ConfigMap map;
-        {
-            WaitCursorRAII _;
-            map = db->requestModel(domain, modelName, version, !version.empty());
-        }
-        loadComponentModelFrom(map);
+        // issued with the widget as context, so the load is dropped if the database is switched meanwhile
+        getAsyncDB().requestModel(domain, modelName, version, !version.empty(), widget, [this](const ConfigMap &result)
+                                  {
+            ConfigMap map = result;
+            loadComponentModelFrom(map); });
     }
 
     // This function stores the current component model
-    bool XRockGUI::storeComponentModel()
+    void XRockGUI::storeComponentModel(std::function<void(bool saved)> done, QObject *context)
     {
         ComponentModelInterface *model = dynamic_cast<ComponentModelInterface *>(bagelGui->getCurrentModel());
         if (!model)
-            return false;
+        {
+            done(false);
+            return;
+        }
         // Get the current model info
         ConfigMap map = model->getModelInfo();
         // Store the returned info to db
-        bool saved;
+        getAsyncDB().storeModel(map, context, [done](const bool &saved)
+                                { done(saved); });
+    }
+
+    AsyncDB &XRockGUI::getAsyncDB()
+    {
+        if (!asyncDb)
         {
-            WaitCursorRAII _;
-            saved = db->storeModel(map);
+            asyncDb.reset(new AsyncDB(db));
         }
-        return saved;
+        // the backend is replaced by the SELECT_* actions and the toolbar
+        if (asyncDb->getDB() != db)
+        {
+            // models requested from the previous database are not opened anymore
+            asyncDb->cancel(widget);
+            asyncDb->setDB(db);
+        }
+        return *asyncDb;
+    }
+
+    ModelSearchCache &XRockGUI::getSearchCache()
+    {
+        // the indices belong to one backend, they are built again for another one
+        if (!searchCache || searchCache->getDB() != db)
+        {
+            searchCache.reset();
+            searchCache.reset(new ModelSearchCache(db));
+        }
+        return *searchCache;
     }
 
     void XRockGUI::currentModelChanged(bagel_gui::ModelInterface *model)
@@ -1701,13 +1932,11 @@ namespace xrock_gui_model
             QWebView *doc = new QWebView();
             doc->page()->setLinkDelegationPolicy(QWebPage::DelegateAllLinks);
             widget->connect(doc, SIGNAL(linkClicked(const QUrl &)), widget, SLOT(openUrl(const QUrl &)));
-            ConfigMap modelMap;
-            {
-                WaitCursorRAII _;
-                modelMap = db->requestModel(domain, model_name, version, true);
-            }
-            if (modelMap["versions"][0].hasKey("data"))
-            {
+            doc->show();
+            getAsyncDB().requestModel(domain, model_name, version, true, doc, [doc](const ConfigMap &result)
+                                      {
+                ConfigMap modelMap = result;
+                if (modelMap["versions"][0].hasKey("data"))
                 {
                     ConfigMap dataMap;
                     if (modelMap["versions"][0]["data"].isMap())
@@ -1722,15 +1951,35 @@ namespace xrock_gui_model
                             doc->setHtml(getHtml2(md).c_str());
                         }
                     }
-                }
-            }
-            doc->show();
+                } });
         }
         else if (name == "apply configuration")
         {
             ConfigMap node = *(bagelGui->getNodeMap(contextNodeName));
             applyConfiguration(node);
         }
+        else if (name == "show dependents")
+        {
+            ConfigMap node = *(bagelGui->getNodeMap(contextNodeName));
+            std::string domain = node["model"]["domain"];
+            std::string model_name = node["model"]["name"];
+            std::string version = node["model"]["versions"][0]["name"];
+            typedef std::vector<std::tuple<std::string, std::string, std::string>> Dependents;
+            getAsyncDB().call<Dependents>([domain, model_name, version](DBInterface &db)
+                                          { return db.requestDependents(domain, model_name, version); },
+                                          widget, [model_name, version](const Dependents &dependents)
+                                          {
+                std::string msg = "Models using " + model_name + " " + version + ":\n";
+                for (const auto &it : dependents)
+                {
+                    msg += "\n" + std::get<1>(it) + " " + std::get<2>(it) + " (" + std::get<0>(it) + ")";
+                }
+                if (dependents.empty())
+                {
+                    msg = "No model uses " + model_name + " " + version + ".";
+                }
+                QMessageBox::information(nullptr, "Dependents", msg.c_str(), QMessageBox::Ok); });
+        }
         // else if (name == "select implementation...")
         // {
         //     showImplementationsDialog();
@@ -1803,6 +2052,7 @@ namespace xrock_gui_model
         
         r.push_back("open model");
         r.push_back("show description");
+        r.push_back("show dependents");
 
         contextNodeName = name;
         return r;
@@ -1944,7 +2194,7 @@ namespace xrock_gui_model
 
     bool XRockGUI::handleAlias()
     {
-        return (env["dbType"] != "FileDB");
+        return (env["dbType"] != "FileDB" && env["dbType"] != "SQLite");
     }
 
 } // end of namespace xrock_gui_model
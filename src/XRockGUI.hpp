@@ -7,6 +7,7 @@
 #pragma once
 #include <iostream>
 #include <fstream>
+#include <functional>
 
 #include <mars/main_gui/MainGUI.h>
 #include <lib_manager/LibInterface.hpp>
@@ -16,10 +17,13 @@
 #include <bagel_gui/PluginInterface.hpp>
 #include <mars/cfg_manager/CFGManagerInterface.h>
 #include "DBInterface.hpp"
+#include "CachingDB.hpp"
 #include "ToolbarBackend.hpp"
 #include "XRockIOLibrary.hpp"
 #include "ConfigureDialogLoader.hpp"
 
+class QObject;
+
 namespace bagel_gui
 {
     class BagelModel;
@@ -30,6 +34,8 @@ namespace xrock_gui_model
 
     class ComponentModelInterface;
     class ComponentModelEditorWidget;
+    class AsyncDB;
+    class ModelSearchCache;
 
     enum struct MenuActions : int
     {
@@ -51,6 +57,7 @@ namespace xrock_gui_model
         SELECT_CLIENT = 22,
         SELECT_MULTIDB = 23,
         SELECT_FILEDB = 24,
+        SELECT_SQLITE = 25,
         RELOAD_MODEL_FROM_DB = 30,
         REMOVE_MODEL_FROM_DB = 31,
         EXPORT_CND_TFENHANCE = 32,
@@ -128,8 +135,9 @@ namespace xrock_gui_model
         // These function load a component model from DB or from a ConfigMap
         void loadComponentModel(const std::string &domain, const std::string &modelName, const std::string &version);
         void loadComponentModelFrom(configmaps::ConfigMap &map);
-        // This function stores the current component model
-        bool storeComponentModel();
+        // This function stores the current component model in the background and reports the result to done
+        // (on the GUI thread), unless context was cancelled or destroyed in the meantime
+        void storeComponentModel(std::function<void(bool saved)> done, QObject *context = nullptr);
 
         // This function applies a ROCK configuration to a ROCK Task with dynamic ports to create a new model
         // TODO: Since the XTypes now know the notion of an dynamic interface, we could remove this and create such functionality
@@ -139,8 +147,13 @@ namespace xrock_gui_model
         // These functions open a dialog to select a component model to be opened/instantiated and then fetch the info from the database (see below)
         void requestModel();
         void addComponent();
-        // Stored a pointer to the currently selected XRock database backend instance
-        std::unique_ptr<DBInterface> db;
+        // Stored a pointer to the currently selected XRock database backend instance, always wrapped
+        // in a CachingDB which serializes the calls of the GUI thread and the AsyncDB worker
+        std::shared_ptr<CachingDB> db;
+        // Runs requests on the currently selected backend in the background, see AsyncDB
+        AsyncDB &getAsyncDB();
+        // Search indices of the domains of the currently selected backend, see ModelSearchCache
+        ModelSearchCache &getSearchCache();
         XRockIOLibrary *ioLibrary;
         std::string getBackend();
         bool handleAlias();
@@ -169,7 +182,19 @@ namespace xrock_gui_model
         std::string resourcesPath;
         ToolbarBackend *toolbarBackend;
         std::map<std::string, ConfigureDialogLoader *> configPlugins;
-
+        std::unique_ptr<AsyncDB> asyncDb;
+        std::unique_ptr<ModelSearchCache> searchCache;
+
+        // Creates a FileDB configured by the "fileDBLoadThreads" and "fileDBWatch" keys of env
+        DBInterface *createFileDB();
+        // Puts a cache of recently requested model versions in front of backend, its size is
+        // taken from the "modelCacheSize" key of env (0 disables caching, the calls are still serialized)
+        CachingDB *createCachingDB(DBInterface *backend);
+        // Combines the servers of a MultiDBConfig.yml, FileDB and SQLite ones are created locally
+        DBInterface *createFederatedDB(const configmaps::ConfigMap &config);
+        // Registers the node infos of the first version of every model (initLoadModels), reusing the
+        // NodeInfoCache for FileDB models which did not change since the last start
+        void preloadNodeInfos(ComponentModelInterface *model, bool simpleTypeGen);
         void loadStartModel();
         void loadModelFromParameter();
         bool loadCart();
@@ -0,0 +1,82 @@
+/**
+ * \file FileDBBench.cpp
+ * \brief Command line tool comparing the parse times of the model files of FileDB directories as yaml and as json
+ **/
+
+#include <configmaps/ConfigData.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace configmaps;
+
+namespace
+{
+    const int rounds = 5;
+
+    // Parses every text rounds times and returns the time in milliseconds
+    template <typename Parse>
+    double measure(const std::vector<std::string> &texts, Parse parse)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; ++i)
+        {
+            for (const auto &text : texts)
+            {
+                parse(text);
+            }
+        }
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: " << argv[0] << " <FileDB directory>..." << std::endl;
+        std::cerr << "  parses every model.yml " << rounds << " times as yaml and as json, e.g." << std::endl;
+        std::cerr << "  configuration/cnd_gui/cnd_db configuration/shader_gui/shader_db" << std::endl;
+        return EXIT_FAILURE;
+    }
+    for (int i = 1; i < argc; ++i)
+    {
+        std::vector<std::string> yaml, json;
+        size_t yamlBytes = 0, jsonBytes = 0;
+        std::error_code ec;
+        for (std::filesystem::recursive_directory_iterator it(argv[i], ec), end; !ec && it != end; it.increment(ec))
+        {
+            if (it->path().filename() != "model.yml")
+            {
+                continue;
+            }
+            std::ifstream in(it->path());
+            std::stringstream content;
+            content << in.rdbuf();
+            yaml.push_back(content.str());
+            json.push_back(ConfigMap::fromYamlString(yaml.back()).toJsonString());
+            yamlBytes += yaml.back().size();
+            jsonBytes += json.back().size();
+        }
+        if (yaml.empty())
+        {
+            std::cerr << argv[i] << ": no model.yml found" << std::endl;
+            return EXIT_FAILURE;
+        }
+        const double yamlTime = measure(yaml, [](const std::string &text)
+                                        { return ConfigMap::fromYamlString(text); });
+        const double jsonTime = measure(json, [](const std::string &text)
+                                        { return ConfigMap::fromJsonString(text); });
+        std::cout << argv[i] << ": " << yaml.size() << " models" << std::endl;
+        std::cout << "  yaml: " << yamlBytes << " bytes, " << yamlTime / rounds << " ms per pass" << std::endl;
+        std::cout << "  json: " << jsonBytes << " bytes, " << jsonTime / rounds << " ms per pass ("
+                  << (jsonTime > 0 ? yamlTime / jsonTime : 0) << "x)" << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,108 @@
+/**
+ * \file FileDBMigrate.cpp
+ * \brief Command line tool to convert a FileDB directory between the single file and the sharded index layout,
+ *        between the model file formats and compressions, and to move its model versions into the blob store
+ **/
+
+#include "../FileDB.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+using namespace xrock_gui_model;
+
+int main(int argc, char **argv)
+{
+    // nothing is converted unless asked for
+    bool changeLayout = false;
+    bool toSharded = false;
+    bool dedup = false;
+    bool changeFormat = false;
+    bool changeCompression = false;
+    bool valid = true;
+    FileDB::ModelFormat format = FileDB::YAML;
+    FileCompression::Format compression = FileCompression::NONE;
+    const char *dir = nullptr;
+    for (int i = 1; i < argc && valid; ++i)
+    {
+        if (strcmp(argv[i], "--sharded") == 0 || strcmp(argv[i], "--single") == 0)
+        {
+            valid = !changeLayout;
+            changeLayout = true;
+            toSharded = strcmp(argv[i], "--sharded") == 0;
+        }
+        else if (strcmp(argv[i], "--dedup") == 0)
+        {
+            dedup = true;
+        }
+        else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+        {
+            ++i;
+            valid = strcmp(argv[i], "yaml") == 0 || strcmp(argv[i], "json") == 0;
+            format = strcmp(argv[i], "json") == 0 ? FileDB::JSON : FileDB::YAML;
+            changeFormat = true;
+        }
+        else if (strcmp(argv[i], "--compression") == 0 && i + 1 < argc)
+        {
+            ++i;
+            valid = FileCompression::parseFormat(argv[i], &compression) && FileCompression::isSupported(compression);
+            changeCompression = true;
+        }
+        else if (!dir && argv[i][0] != '-')
+        {
+            dir = argv[i];
+        }
+        else
+        {
+            valid = false;
+        }
+    }
+    if (!dir || !valid || !(changeLayout || changeFormat || changeCompression || dedup))
+    {
+        std::cerr << "usage: " << argv[0] << " [--sharded|--single] [--dedup] [--format yaml|json] [--compression none|gzip|zstd] <FileDB directory>" << std::endl;
+        std::cerr << "  --sharded: moves the index of info.yml into a versions.yml per model" << std::endl;
+        std::cerr << "  --single: moves the index back into info.yml" << std::endl;
+        std::cerr << "  --format, --compression: writes all model files again in the given format," << std::endl;
+        std::cerr << "  the one not given stays as it is" << std::endl;
+        std::cerr << "  --dedup: stores identical model versions only once and deletes unused blobs" << std::endl;
+        std::cerr << "  no other process may write to the database meanwhile" << std::endl;
+        return EXIT_FAILURE;
+    }
+    FileDB db;
+    db.setDbAddress(dir);
+    FileDB::ModelFormat currentFormat;
+    FileCompression::Format currentCompression;
+    if (!db.detectFileFormat(&currentFormat, &currentCompression))
+    {
+        return EXIT_FAILURE;
+    }
+    // the index files written by the migration keep the compression as well
+    db.setModelFormat(changeFormat ? format : currentFormat);
+    db.setCompression(changeCompression ? compression : currentCompression);
+    if (changeLayout && !db.migrateLayout(toSharded))
+    {
+        return EXIT_FAILURE;
+    }
+    std::cout << "database uses the " << (db.isSharded() ? "sharded" : "single file") << " layout" << std::endl;
+    if (changeFormat || changeCompression)
+    {
+        size_t numVersions = 0;
+        if (!db.rewriteModelFiles(&numVersions))
+        {
+            return EXIT_FAILURE;
+        }
+        std::cout << "rewrote " << numVersions << " model versions" << std::endl;
+    }
+    if (dedup)
+    {
+        size_t numVersions = 0, numBlobs = 0;
+        if (!db.deduplicateVersions(&numVersions, &numBlobs))
+        {
+            return EXIT_FAILURE;
+        }
+        std::cout << "moved " << numVersions << " model versions into the blob store, "
+                  << numBlobs << " blobs in use" << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,30 @@
+/**
+ * \file FileDBPack.cpp
+ * \brief Command line tool to build the packed snapshot of a FileDB directory
+ **/
+
+#include "../FileDB.hpp"
+
+#include <cstdlib>
+#include <iostream>
+
+using namespace xrock_gui_model;
+
+int main(int argc, char **argv)
+{
+    if (argc != 2)
+    {
+        std::cerr << "usage: " << argv[0] << " <FileDB directory>" << std::endl;
+        std::cerr << "  writes <FileDB directory>/snapshot.xpack" << std::endl;
+        return EXIT_FAILURE;
+    }
+    FileDB db;
+    db.setDbAddress(argv[1]);
+    size_t numVersions = 0;
+    if (!db.writeSnapshot(&numVersions))
+    {
+        return EXIT_FAILURE;
+    }
+    std::cout << "packed " << numVersions << " model versions" << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,34 @@
+/**
+ * \file SQLiteImport.cpp
+ * \brief Command line tool copying all models of a FileDB directory into a SQLite database
+ **/
+
+#include "../FileDB.hpp"
+#include "../SQLiteDB.hpp"
+
+#include <cstdlib>
+#include <iostream>
+
+using namespace xrock_gui_model;
+
+int main(int argc, char **argv)
+{
+    if (argc != 3)
+    {
+        std::cerr << "usage: " << argv[0] << " <FileDB directory> <SQLite file>" << std::endl;
+        std::cerr << "  copies every version of every model into the SQLite database, which is created if needed;" << std::endl;
+        std::cerr << "  versions which exist in both are replaced" << std::endl;
+        return EXIT_FAILURE;
+    }
+    FileDB source;
+    source.setDbAddress(argv[1]);
+    SQLiteDB target;
+    target.setDbAddress(argv[2]);
+    size_t numVersions = 0;
+    if (!target.importFrom(source, &numVersions))
+    {
+        return EXIT_FAILURE;
+    }
+    std::cout << "imported " << numVersions << " model versions into " << target.getDbFile() << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <cstddef>
+#include <map>
+#include <memory>
+
+namespace xrock_gui_model
+{
+
+    // Ordered map whose copies share the index and the values until they are changed (copy-on-write).
+    // Copying the map is O(1). The first change of a copy duplicates the index, which only holds pointers,
+    // and modify() duplicates the one value it returns if another copy still uses it.
+    // The values reached through find() and the iterators are not const because configmaps::ConfigMap
+    // can only be read through its non-const operator[]; they must not be changed, use modify() or set().
+    // NOTE: Like the containers it replaces, a map and its copies must be used from one thread.
+    template <typename Key, typename Value>
+    class CowMap
+    {
+    public:
+        typedef std::map<Key, std::shared_ptr<Value>> Index;
+        typedef typename Index::const_iterator const_iterator;
+
+        CowMap() : index(std::make_shared<Index>())
+        {
+        }
+
+        const_iterator begin() const
+        {
+            return index->begin();
+        }
+
+        const_iterator end() const
+        {
+            return index->end();
+        }
+
+        size_t size() const
+        {
+            return index->size();
+        }
+
+        bool empty() const
+        {
+            return index->empty();
+        }
+
+        bool contains(const Key &key) const
+        {
+            return index->find(key) != index->end();
+        }
+
+        // Value to read or null
+        Value *find(const Key &key) const
+        {
+            auto it = index->find(key);
+            return it == index->end() ? nullptr : it->second.get();
+        }
+
+        // Value to change or null, it is copied first if another copy of the map uses it
+        Value *modify(const Key &key)
+        {
+            if (!contains(key))
+            {
+                return nullptr;
+            }
+            detach();
+            std::shared_ptr<Value> &value = (*index)[key];
+            if (value.use_count() > 1)
+            {
+                value = std::make_shared<Value>(*value);
+            }
+            return value.get();
+        }
+
+        void set(const Key &key, const Value &value)
+        {
+            detach();
+            (*index)[key] = std::make_shared<Value>(value);
+        }
+
+        bool erase(const Key &key)
+        {
+            if (!contains(key))
+            {
+                return false;
+            }
+            detach();
+            index->erase(key);
+            return true;
+        }
+
+    private:
+        std::shared_ptr<Index> index;
+
+        void detach()
+        {
+            if (index.use_count() > 1)
+            {
+                index = std::make_shared<Index>(*index);
+            }
+        }
+    };
+
+} // end of namespace xrock_gui_model
@@ -0,0 +1,149 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace xrock_gui_model
+{
+
+    // Fixed number of worker threads executing queued tasks in FIFO order.
+    // NOTE: Tasks must not wait for other tasks of the same pool.
+    class ThreadPool
+    {
+    public:
+        explicit ThreadPool(size_t numThreads) : stopping(false)
+        {
+            if (numThreads == 0)
+            {
+                numThreads = 1;
+            }
+            for (size_t i = 0; i < numThreads; ++i)
+            {
+                workers.emplace_back([this]
+                                     { run(); });
+            }
+        }
+
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            condition.notify_all();
+            for (auto &worker : workers)
+            {
+                worker.join();
+            }
+        }
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        size_t size() const
+        {
+            return workers.size();
+        }
+
+        template <typename F>
+        std::future<std::invoke_result_t<F>> submit(F f)
+        {
+            typedef std::invoke_result_t<F> Result;
+            auto task = std::make_shared<std::packaged_task<Result()>>(std::move(f));
+            std::future<Result> result = task->get_future();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                tasks.push([task]
+                           { (*task)(); });
+            }
+            condition.notify_one();
+            return result;
+        }
+
+        // Calls fn(i) for all i in [0, n) on the workers and blocks until all calls are done.
+        // If calls throw, the exception of the lowest index is rethrown afterwards.
+        template <typename F>
+        void parallelFor(size_t n, F fn)
+        {
+            if (n == 0)
+            {
+                return;
+            }
+            if (n == 1 || workers.size() == 1)
+            {
+                for (size_t i = 0; i < n; ++i)
+                {
+                    fn(i);
+                }
+                return;
+            }
+            std::atomic<size_t> next(0);
+            std::vector<std::exception_ptr> errors(n);
+            std::vector<std::future<void>> running;
+            size_t numTasks = std::min(n, workers.size());
+            for (size_t t = 0; t < numTasks; ++t)
+            {
+                running.push_back(submit([&]
+                                         {
+                    for (size_t i = next++; i < n; i = next++)
+                    {
+                        try
+                        {
+                            fn(i);
+                        }
+                        catch (...)
+                        {
+                            errors[i] = std::current_exception();
+                        }
+                    } }));
+            }
+            for (auto &r : running)
+            {
+                r.wait();
+            }
+            for (auto &e : errors)
+            {
+                if (e)
+                {
+                    std::rethrow_exception(e);
+                }
+            }
+        }
+
+    private:
+        std::vector<std::thread> workers;
+        std::queue<std::function<void()>> tasks;
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool stopping;
+
+        void run()
+        {
+            while (true)
+            {
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    condition.wait(lock, [this]
+                                   { return stopping || !tasks.empty(); });
+                    if (stopping && tasks.empty())
+                    {
+                        return;
+                    }
+                    task = std::move(tasks.front());
+                    tasks.pop();
+                }
+                task();
+            }
+        }
+    };
+
+} // end of namespace xrock_gui_model